@@ -0,0 +1,15 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace dependency_manager {
+std::string read_head_commit(const fs::path &repo);
+void write_dep_manifest(const std::string &name, const std::string &source,
+                        const std::string &tag, const std::string &rev,
+                        const std::string &hash, const fs::path &dep_dir);
+bool dep_manifest_matches(const std::string &name, const std::string &source,
+                          const std::string &tag, const fs::path &dep_dir);
+} // namespace dependency_manager
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "git_dependency.hpp"
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace dependency_manager {
+struct DepUsage {
+  std::vector<std::string> include_dirs;
+  std::vector<std::string> defines;
+  std::vector<std::string> link_libraries;
+  std::vector<std::string> dependencies;
+};
+
+fs::path usage_path(const std::string &profile_key, const std::string &name);
+void request_codemodel(const fs::path &build);
+fs::path usage_script(const fs::path &build);
+bool interface_only(const fs::path &build, const std::string &build_type);
+bool codemodel_usage(const fs::path &source, const fs::path &build,
+                     const std::string &build_type, DepUsage &usage);
+DepUsage header_only_usage(const fs::path &source);
+void write_usage(const fs::path &path, const DepUsage &usage);
+bool read_usage(const fs::path &path, DepUsage &usage);
+void export_usage(const std::string &name, const fs::path &source,
+                  const fs::path &build, const BuildVariant &variant,
+                  bool header_only,
+                  const std::vector<std::string> &dependencies);
+std::vector<std::string>
+link_order(const std::vector<std::string> &names,
+           const std::map<std::string, DepUsage> &all);
+} // namespace dependency_manager
@@ -1,30 +1,73 @@
 #pragma once
 
+#include "../project_management/parser.hpp"
 #include <cstdlib>
 #include <filesystem>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace fs = std::filesystem;
 
+namespace utils {
+class Jobserver;
+}
+
 namespace dependency_manager {
+struct BuildVariant {
+  std::string build_type;
+  std::string generator;
+  std::vector<std::string> cmake_args;
+  std::string key;
+  std::string profile_key;
+  unsigned jobs = 0;
+};
+
+BuildVariant make_build_variant(const project_management::Config &cfg,
+                                const std::string &profile, unsigned jobs = 0);
+fs::path variant_build_dir(const std::string &name,
+                           const BuildVariant &variant);
 std::string exec(const std::string &cmd);
+std::string shell_quote(const std::string &value);
+utils::Jobserver &shared_jobserver(unsigned jobs);
 std::string get_commit_rev(const std::string &repo_path);
 std::string get_latest_commit_hash(const std::string &repo_path);
 std::string get_commit_hash_from_tag(const std::string &tag,
                                      const std::string &repo_path);
+std::vector<fs::path> lock_files(const fs::path &dir,
+                                 std::vector<fs::path> *dirs = nullptr);
 std::string hash_directory(const fs::path &dir);
-void write_lock(const std::string &name, const std::string &rev,
+void write_lock(const fs::path &path, const std::string &rev,
                 const std::string &hash);
 bool check_lock(const std::string &name, const std::string &rev,
                 const std::string &hash);
-void ensure_git_dep(const std::string &name, const std::string &git_url,
-                    const std::string &tag = "");
-void install_from_url(const std::string &url);
-void install_all_from_config();
+bool check_lock_strict(const std::string &name, const std::string &expected_rev,
+                       const std::string &expected_hash);
+bool is_header_only(const fs::path &dir,
+                    const project_management::Dependency &dep);
+bool is_variant_built(const fs::path &build, const std::string &commit);
+void configure_cmake(const fs::path &source, const fs::path &build,
+                     const BuildVariant &variant,
+                     const std::vector<fs::path> &prefixes = {});
+void compile_cmake(const fs::path &build, const BuildVariant &variant,
+                   const std::string &commit);
+void build_cmake(const fs::path &source, const fs::path &build,
+                 const BuildVariant &variant, const std::string &commit,
+                 const std::vector<fs::path> &prefixes = {});
+void ensure_git_dep(const std::string &name,
+                    const project_management::Dependency &dep,
+                    const BuildVariant &variant);
+void install_from_url(const std::string &url, const std::string &profile = "",
+                      unsigned jobs = 0);
+std::unordered_map<std::string, project_management::Dependency>
+git_dependencies(const project_management::Config &cfg);
+void install_all_from_config(const std::string &profile = "",
+                             unsigned jobs = 0);
 void find_include_dirs(const fs::path &basePath,
                        std::vector<std::string> &includes);
-void update_git_dependency(const std::string &name, const std::string &url,
-                           const std::string &tag);
-void update_all_dependencies();
+void update_git_dependency(const std::string &name,
+                           const project_management::Dependency &dep,
+                           const BuildVariant &variant);
+void update_all_dependencies(const std::string &profile = "",
+                             unsigned jobs = 0);
 } // namespace dependency_manager
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../project_management/parser.hpp"
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace dependency_manager {
+fs::path mirror_dir(const std::string &url);
+fs::path ensure_mirror(const std::string &url);
+std::string mirror_commit(const std::string &url, const std::string &tag);
+std::string mirror_latest_tag(const std::string &url);
+bool mirror_has_tag(const std::string &url, const std::string &tag);
+void clone_from_mirror(const fs::path &path, const std::string &url);
+void checkout_from_mirror(const fs::path &repo, const std::string &url,
+                          const std::string &commit);
+std::string shallow_fetch(const fs::path &repo, const std::string &url,
+                          const std::string &tag);
+void apply_sparse(const fs::path &repo, const std::vector<std::string> &paths);
+std::string checkout_source(const project_management::Dependency &dep);
+std::string fetch_dependency(const fs::path &repo,
+                             const project_management::Dependency &dep);
+void checkout_dependency(const fs::path &repo,
+                         const project_management::Dependency &dep,
+                         const std::string &commit);
+} // namespace dependency_manager
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "../utils/thread_pool.hpp"
+#include "git_dependency.hpp"
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dependency_manager {
+struct PipelineLimits {
+  unsigned fetch = 1;
+  unsigned verify = 1;
+  unsigned build = 1;
+};
+
+struct DepNode;
+
+class InstallPipeline {
+public:
+  using Listener = std::function<void(const std::string &name, bool ok)>;
+
+  InstallPipeline(const BuildVariant &variant, const PipelineLimits &limits);
+  ~InstallPipeline();
+
+  InstallPipeline(const InstallPipeline &) = delete;
+  InstallPipeline &operator=(const InstallPipeline &) = delete;
+
+  void add(const std::string &name, const project_management::Dependency &dep);
+  void set_listener(Listener listener);
+  bool finished(const std::string &name);
+  void wait_configured();
+  void wait();
+  bool run();
+
+private:
+  DepNode *insert(const std::string &name,
+                  const project_management::Dependency &dep,
+                  const std::string &parent);
+  template <typename F> void submit(utils::ThreadPool &pool, F stage);
+  void fetch(DepNode &node);
+  void verify(DepNode &node);
+  void configure(DepNode &node, const std::vector<fs::path> &prefixes);
+  void build(DepNode &node);
+  void fail(DepNode &node, const std::string &reason);
+  void schedule();
+  void settle(std::unique_lock<std::mutex> &lock);
+
+  BuildVariant variant_;
+  std::map<std::string, std::unique_ptr<DepNode>> nodes_;
+  std::vector<std::pair<std::string, bool>> finished_;
+  Listener listener_;
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  size_t pending_ = 0;
+  size_t notifying_ = 0;
+  bool aborted_ = false;
+  utils::ThreadPool fetch_pool_;
+  utils::ThreadPool verify_pool_;
+  utils::ThreadPool build_pool_;
+};
+
+PipelineLimits pipeline_limits(unsigned jobs);
+bool install_dependencies(
+    const std::unordered_map<std::string, project_management::Dependency>
+        &roots,
+    const BuildVariant &variant, const PipelineLimits &limits);
+} // namespace dependency_manager
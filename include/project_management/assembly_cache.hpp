@@ -1,10 +1,35 @@
 #pragma once
 
+#include "compile_cmd_generator.hpp"
 #include "parser.hpp"
+#include <map>
 #include <string>
+#include <vector>
 
 namespace project_management {
+struct ObjectRecord {
+  std::string command_hash;
+  std::string inputs_hash;
+  std::vector<std::string> inputs;
+};
+
+struct BuildRecord {
+  std::string link_hash;
+  std::map<std::string, ObjectRecord> objects;
+};
+
+std::string hash_string(const std::string &data);
 std::string hash_source_files(const Config &config);
-bool needs_rebuild(const Config &config);
-void update_cache(const Config &config);
-} // namespace project_management
\ No newline at end of file
+std::vector<std::string> parse_depfile(const fs::path &depfile);
+std::vector<std::string>
+scan_includes(const fs::path &source,
+              const std::vector<std::string> &include_dirs);
+std::string link_hash(const BuildPlan &plan);
+BuildRecord load_build_record(const BuildPlan &plan);
+std::vector<const CompileUnit *> stale_units(const BuildPlan &plan,
+                                             const BuildRecord &stored);
+void record_objects(const std::vector<const CompileUnit *> &built,
+                    BuildRecord &record);
+bool needs_link(const BuildPlan &plan, const BuildRecord &stored);
+void save_build_record(const BuildPlan &plan, const BuildRecord &record);
+} // namespace project_management
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "parser.hpp"
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace project_management {
+struct BenchOptions {
+  std::string profile;
+  std::string baseline;
+  std::string filter;
+  int warmup = -1;
+  int repeat = -1;
+  int cpu = -1;
+  unsigned jobs = 0;
+};
+
+struct BenchStats {
+  std::string name;
+  std::vector<double> samples;
+  double min = 0;
+  double median = 0;
+  double mean = 0;
+  double stddev = 0;
+  double ci95 = 0;
+};
+
+BenchStats bench_stats(const std::string &name,
+                       const std::vector<double> &samples);
+std::string bench_revision();
+std::vector<fs::path> build_benchmarks(const Config &cfg,
+                                       const std::string &profile,
+                                       unsigned jobs);
+void bench(const BenchOptions &options);
+} // namespace project_management
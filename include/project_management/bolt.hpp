@@ -0,0 +1,14 @@
+#pragma once
+
+#include "parser.hpp"
+#include "runner.hpp"
+#include <filesystem>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace project_management {
+fs::path bolt_dir(const fs::path &binary);
+bool bolt_build(const Config &cfg, const RunOptions &options,
+                dependency_manager::InstallPipeline *pipeline = nullptr);
+} // namespace project_management
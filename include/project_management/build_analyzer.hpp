@@ -0,0 +1,28 @@
+#pragma once
+
+#include "compile_cmd_generator.hpp"
+#include "runner.hpp"
+#include <cstddef>
+#include <map>
+#include <string>
+
+namespace project_management {
+struct TimeEntry {
+  double total_ms = 0;
+  size_t count = 0;
+};
+
+struct BuildAnalysis {
+  std::map<std::string, TimeEntry> units;
+  std::map<std::string, TimeEntry> headers;
+  std::map<std::string, TimeEntry> templates;
+  std::map<std::string, TimeEntry> phases;
+  std::map<std::string, TimeEntry> timers;
+};
+
+bool read_time_trace(const fs::path &path, const std::string &unit,
+                     BuildAnalysis &analysis);
+bool read_time_report(const std::string &output, const std::string &unit,
+                      BuildAnalysis &analysis);
+void analyze_build(const RunOptions &options, size_t top = 10);
+} // namespace project_management
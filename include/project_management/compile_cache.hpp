@@ -0,0 +1,11 @@
+#pragma once
+
+#include "compile_cmd_generator.hpp"
+#include <string>
+
+namespace project_management {
+std::string compiler_identity(const std::string &compiler);
+bool is_clang(const std::string &compiler);
+bool restore_object(const CompileUnit &unit, const std::string &compiler_id);
+void store_object(const CompileUnit &unit, const std::string &compiler_id);
+} // namespace project_management
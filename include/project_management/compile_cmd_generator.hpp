@@ -1,6 +1,40 @@
 #pragma once
-#include <sstream>
+#include "parser.hpp"
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
 
 namespace project_management {
-std::stringstream generate_compile_cmd();
-}
\ No newline at end of file
+struct CompileUnit {
+  fs::path source;
+  fs::path object;
+  fs::path depfile;
+  std::string command;
+  std::string identity;
+};
+
+struct BuildPlan {
+  std::string profile_key;
+  fs::path build_dir;
+  fs::path cache_dir;
+  fs::path output;
+  fs::path published;
+  std::vector<CompileUnit> units;
+  std::string link_cmd;
+  std::string compile_flags;
+  std::string link_flags;
+  std::vector<std::string> include_dirs;
+  std::vector<std::string> dependencies;
+  std::vector<std::string> link_inputs;
+};
+
+std::string profile_key(const Config &cfg, const std::string &profile,
+                        const std::vector<std::string> &flags);
+BuildPlan
+generate_compile_cmd(const Config &cfg, const std::string &profile,
+                     const std::vector<std::string> &flags,
+                     const std::vector<std::string> &stage_flags = {},
+                     const std::vector<std::string> &link_flags = {});
+} // namespace project_management
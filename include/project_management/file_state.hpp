@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace project_management {
+struct FileState {
+  uint64_t size = 0;
+  int64_t mtime_ns = 0;
+  uint64_t inode = 0;
+  std::string hash;
+  bool stable = false;
+  bool touched = false;
+};
+
+class FileStateCache {
+public:
+  explicit FileStateCache(fs::path db_path);
+
+  std::string hash(const std::string &path);
+  void prefetch(const std::vector<std::string> &paths);
+  void save();
+
+private:
+  bool lookup(const std::string &path, const struct stat &st,
+              std::string &hash);
+  void store(const std::string &path, const struct stat &st,
+             const std::string &hash);
+
+  fs::path db_path_;
+  std::unordered_map<std::string, FileState> entries_;
+  std::mutex mutex_;
+  bool dirty_ = false;
+};
+
+FileStateCache &file_state();
+void save_file_state();
+} // namespace project_management
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "compile_cmd_generator.hpp"
+#include "runner.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace project_management {
+struct HeaderCost {
+  size_t fan_in = 0;
+  uint64_t size = 0;
+  uint64_t inclusive_bytes = 0;
+};
+
+struct DependencyPull {
+  size_t count = 0;
+  uint64_t bytes = 0;
+  std::map<std::string, uint64_t> headers;
+};
+
+struct IncludeReport {
+  size_t units = 0;
+  uint64_t total_bytes = 0;
+  std::map<std::string, HeaderCost> headers;
+  std::map<std::string, DependencyPull> dependency_pulls;
+};
+
+bool read_include_tree(const std::string &output, const fs::path &source,
+                       IncludeReport &report);
+void analyze_includes(const RunOptions &options, size_t top = 20);
+} // namespace project_management
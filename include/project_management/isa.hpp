@@ -0,0 +1,16 @@
+#pragma once
+
+#include "parser.hpp"
+#include "runner.hpp"
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace project_management {
+const std::vector<std::string> &isa_levels(const Config &cfg,
+                                           const std::string &profile);
+bool isa_build(const Config &cfg, const RunOptions &options,
+               dependency_manager::InstallPipeline *pipeline = nullptr);
+} // namespace project_management
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "parser.hpp"
+#include <string>
+#include <vector>
+
+namespace project_management {
+struct LtoFlags {
+  std::vector<std::string> compile;
+  std::vector<std::string> link;
+  std::string cache_dir;
+  bool gcc = false;
+};
+
+LtoFlags lto_flags(const Config &cfg, const std::vector<std::string> &flags);
+void prepare_lto_link(const Config &cfg, LtoFlags &lto);
+} // namespace project_management
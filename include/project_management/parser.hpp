@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <map>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -10,6 +12,9 @@ struct Dependency {
   std::string git;
   std::string tag;
   std::string path;
+  bool shallow = false;
+  std::vector<std::string> sparse;
+  std::optional<bool> header_only;
 };
 
 struct Config {
@@ -21,10 +26,24 @@ struct Config {
   std::string sources;
   std::string include;
   std::string build;
+  std::string bench;
+  unsigned jobs = 0;
+  bool compile_cache = true;
+  bool shallow_deps = false;
+  std::string trace;
+  std::string lto;
+  std::string pgo_profile = "--release";
+  std::vector<std::string> pgo_training;
+  std::string bench_profile = "--release";
+  std::string bench_baseline;
+  unsigned bench_warmup = 1;
+  unsigned bench_repeat = 10;
+  int bench_cpu = -1;
   std::unordered_map<std::string, Dependency> dependencies;
   std::vector<std::string> libraries;
   std::vector<std::string> lib_dirs;
   std::map<std::string, std::vector<std::string>> profiles;
+  std::map<std::string, std::vector<std::string>> profile_isa;
 };
 Config parse(std::string config_file);
 void save(const std::string &path, const Config &config);
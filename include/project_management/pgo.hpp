@@ -0,0 +1,15 @@
+#pragma once
+
+#include "parser.hpp"
+#include "runner.hpp"
+#include <filesystem>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace project_management {
+fs::path pgo_dir(const Config &cfg, const std::string &profile);
+std::string pgo_stamp(const Config &cfg, const std::string &profile);
+bool pgo_build(const Config &cfg, const RunOptions &options,
+               dependency_manager::InstallPipeline *pipeline = nullptr);
+} // namespace project_management
@@ -1,9 +1,31 @@
 #pragma once
 
-#include <sstream>
+#include "compile_cmd_generator.hpp"
+#include "parser.hpp"
 #include <string>
+#include <vector>
+
+namespace dependency_manager {
+class InstallPipeline;
+}
 
 namespace project_management {
+struct RunOptions {
+  std::string profile = "--test";
+  unsigned jobs = 0;
+  std::string trace;
+  bool pgo = false;
+  bool bolt = false;
+  std::vector<std::string> stage_flags;
+  std::vector<std::string> link_flags;
+};
+
 int run_command(const std::string &cmd);
-void run(std::stringstream &compile_cmd, const std::string &type);
-} // namespace project_management
\ No newline at end of file
+void publish_output(const BuildPlan &plan);
+unsigned resolve_jobs(const Config &cfg, const RunOptions &options);
+std::vector<std::string> profile_flags(const Config &cfg,
+                                       const std::string &profile);
+bool build(const Config &cfg, const RunOptions &options,
+           dependency_manager::InstallPipeline *pipeline = nullptr);
+void run(const RunOptions &options);
+} // namespace project_management
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace project_management {
+struct SyntheticProject {
+  unsigned sources = 200;
+  unsigned headers = 100;
+  unsigned depth = 4;
+  unsigned deps = 4;
+  unsigned local_deps = 2;
+};
+
+struct SelfBenchOptions {
+  SyntheticProject project;
+  fs::path dir = fs::temp_directory_path() / "zyn-self-bench";
+  fs::path output = "zyn-self-bench.json";
+  unsigned repeat = 3;
+  unsigned jobs = 0;
+};
+
+void generate_project(const fs::path &dir, const SyntheticProject &spec);
+void self_bench(const std::string &argv0, const SelfBenchOptions &options);
+} // namespace project_management
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace utils {
+inline void write_u32(std::ostream &out, uint32_t value) {
+  unsigned char bytes[4];
+  for (int i = 0; i < 4; ++i)
+    bytes[i] = static_cast<unsigned char>(value >> (8 * i));
+  out.write(reinterpret_cast<const char *>(bytes), 4);
+}
+
+inline bool read_u32(std::istream &in, uint32_t &value) {
+  unsigned char bytes[4];
+  if (!in.read(reinterpret_cast<char *>(bytes), 4))
+    return false;
+  value = 0;
+  for (int i = 0; i < 4; ++i)
+    value |= static_cast<uint32_t>(bytes[i]) << (8 * i);
+  return true;
+}
+
+inline void write_u64(std::ostream &out, uint64_t value) {
+  unsigned char bytes[8];
+  for (int i = 0; i < 8; ++i)
+    bytes[i] = static_cast<unsigned char>(value >> (8 * i));
+  out.write(reinterpret_cast<const char *>(bytes), 8);
+}
+
+inline bool read_u64(std::istream &in, uint64_t &value) {
+  unsigned char bytes[8];
+  if (!in.read(reinterpret_cast<char *>(bytes), 8))
+    return false;
+  value = 0;
+  for (int i = 0; i < 8; ++i)
+    value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+  return true;
+}
+
+inline void write_str(std::ostream &out, const std::string &value) {
+  write_u32(out, static_cast<uint32_t>(value.size()));
+  out.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+inline bool read_str(std::istream &in, std::string &value) {
+  uint32_t size;
+  if (!read_u32(in, size) || size > (1u << 20))
+    return false;
+  value.resize(size);
+  return static_cast<bool>(in.read(&value[0], size));
+}
+} // namespace utils
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace utils {
+class MappedFile {
+public:
+  explicit MappedFile(const fs::path &path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  void will_need() const;
+  const unsigned char *data() const { return data_; }
+  size_t size() const { return size_; }
+
+private:
+  const unsigned char *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+uint64_t xxh64(const void *data, size_t len, uint64_t seed = 0);
+std::string to_hex(uint64_t value);
+std::string fast_hash(const std::string &data);
+std::string fast_hash_file(const fs::path &path);
+std::vector<std::string> fast_hash_files(const std::vector<std::string> &paths,
+                                         unsigned jobs = 0);
+} // namespace utils
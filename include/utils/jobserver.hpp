@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace utils {
+class Jobserver {
+public:
+  explicit Jobserver(unsigned jobs);
+  ~Jobserver();
+
+  Jobserver(const Jobserver &) = delete;
+  Jobserver &operator=(const Jobserver &) = delete;
+
+  void acquire();
+  void release();
+  unsigned jobs() const { return jobs_; }
+  bool owner() const { return owner_; }
+
+  class Token {
+  public:
+    explicit Token(Jobserver &server) : server_(server) { server_.acquire(); }
+    ~Token() { server_.release(); }
+
+    Token(const Token &) = delete;
+    Token &operator=(const Token &) = delete;
+
+  private:
+    Jobserver &server_;
+  };
+
+private:
+  bool join_existing();
+  bool read_token(char &token);
+
+  int read_fd_ = -1;
+  int write_fd_ = -1;
+  unsigned jobs_ = 1;
+  bool owner_ = false;
+  bool fifo_ = false;
+  bool implicit_taken_ = false;
+  bool reading_ = false;
+  int wake_fds_[2] = {-1, -1};
+  bool had_makeflags_ = false;
+  std::string saved_makeflags_;
+  std::mutex mutex_;
+  std::condition_variable released_;
+  std::vector<char> held_;
+};
+} // namespace utils
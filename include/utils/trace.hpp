@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace utils {
+class TraceScope {
+public:
+  TraceScope(const char *category, std::string name);
+  ~TraceScope();
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+  const char *category_;
+  std::string name_;
+  int64_t start_us_ = -1;
+};
+
+void start_trace();
+void stop_trace();
+bool write_trace(const std::filesystem::path &path);
+void set_thread_name(const std::string &name);
+} // namespace utils
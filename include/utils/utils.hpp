@@ -1,6 +1,14 @@
 #pragma once
+#include <filesystem>
 #include <string>
 
 namespace utils {
+struct ProcessResult {
+  int exit_code;
+  std::string output;
+};
+
 std::string input_with_prompt(const std::string &prompt);
-}
+ProcessResult run_captured(const std::string &cmd);
+std::filesystem::path user_cache_dir();
+} // namespace utils
@@ -1,124 +1,339 @@
 #include "../include/project_management/assembly_cache.hpp"
+#include "../include/project_management/file_state.hpp"
+#include "../include/utils/binary_io.hpp"
+#include "../include/utils/hashing.hpp"
+#include "../include/utils/trace.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
-#include <openssl/sha.h>
-#include <sstream>
+#include <regex>
+#include <set>
 #include <string>
+#include <unordered_map>
 
 namespace fs = std::filesystem;
 
 namespace project_management {
 
-std::string hash_file_contents(const fs::path &file_path) {
-  std::ifstream file(file_path, std::ios::binary);
-  if (!file) {
-    throw std::runtime_error("Could not open file: " + file_path.string());
+static const char deps_db_magic[8] = {'Z', 'Y', 'N', 'D', 'E', 'P', '0', '2'};
+
+std::string hash_string(const std::string &data) {
+  return utils::fast_hash(data);
+}
+
+bool is_header(const fs::path &path) {
+  static const char *extensions[] = {".h",   ".hh",  ".hpp", ".hxx",
+                                     ".inl", ".ipp", ".tpp"};
+  const std::string ext = path.extension().string();
+  for (const char *candidate : extensions) {
+    if (ext == candidate)
+      return true;
   }
+  return false;
+}
 
-  SHA256_CTX sha_context;
-  SHA256_Init(&sha_context);
+std::string hash_source_files(const Config &config) {
+  std::vector<std::string> files;
 
-  char buffer[4096];
-  while (file.read(buffer, sizeof(buffer))) {
-    SHA256_Update(&sha_context, buffer, file.gcount());
+  for (const auto &entry : fs::recursive_directory_iterator(config.sources)) {
+    if (entry.is_regular_file() &&
+        entry.path().extension() == "." + config.language) {
+      files.push_back(entry.path().string());
+    }
+  }
+
+  if (fs::is_directory(config.include)) {
+    for (const auto &entry : fs::recursive_directory_iterator(config.include)) {
+      if (entry.is_regular_file() && is_header(entry.path())) {
+        files.push_back(entry.path().string());
+      }
+    }
   }
-  SHA256_Update(&sha_context, buffer, file.gcount());
 
-  unsigned char hash[SHA256_DIGEST_LENGTH];
-  SHA256_Final(hash, &sha_context);
+  std::sort(files.begin(), files.end());
+  file_state().prefetch(files);
 
-  std::stringstream ss;
-  for (unsigned char byte : hash) {
-    ss << std::hex << std::setw(2) << std::setfill('0')
-       << static_cast<int>(byte);
+  std::string digest;
+  for (const auto &file : files) {
+    digest += file_state().hash(file);
   }
 
-  return ss.str();
+  return utils::fast_hash(digest);
 }
 
-std::string hash_source_files(const Config &config) {
-  SHA256_CTX sha_context;
-  SHA256_Init(&sha_context);
+std::vector<std::string> parse_depfile(const fs::path &depfile) {
+  std::ifstream in(depfile, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("Could not open depfile: " + depfile.string());
+  }
 
-  for (const auto &entry : fs::recursive_directory_iterator(config.sources)) {
-    if (entry.is_regular_file() &&
-        entry.path().extension() == "." + config.language) {
-      std::string file_hash = hash_file_contents(entry.path());
-      SHA256_Update(&sha_context, file_hash.c_str(), file_hash.size());
+  std::string content((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+  std::vector<std::string> inputs;
+  std::string current;
+  bool in_prerequisites = false;
+
+  auto flush = [&]() {
+    if (!current.empty()) {
+      if (in_prerequisites)
+        inputs.push_back(current);
+      current.clear();
+    }
+  };
+
+  for (size_t i = 0; i < content.size(); ++i) {
+    char c = content[i];
+    if (c == '\\' && i + 1 < content.size()) {
+      char next = content[i + 1];
+      if (next == '\n' || next == '\r') {
+        flush();
+        ++i;
+        continue;
+      }
+      if (next == ' ' || next == '#' || next == '\\') {
+        current.push_back(next);
+        ++i;
+        continue;
+      }
+    }
+    if (c == '$' && i + 1 < content.size() && content[i + 1] == '$') {
+      current.push_back('$');
+      ++i;
+      continue;
     }
+    bool at_end = i + 1 == content.size();
+    if (!in_prerequisites && c == ':' &&
+        (at_end || std::isspace(static_cast<unsigned char>(content[i + 1])))) {
+      current.clear();
+      in_prerequisites = true;
+      continue;
+    }
+    if (std::isspace(static_cast<unsigned char>(c))) {
+      flush();
+      continue;
+    }
+    current.push_back(c);
   }
+  flush();
+
+  return inputs;
+}
+
+static bool inside_zyn(const fs::path &path) {
+  return !path.empty() && *path.begin() == ".zyn";
+}
+
+std::vector<std::string>
+scan_includes(const fs::path &source,
+              const std::vector<std::string> &include_dirs) {
+  utils::TraceScope trace("scan", "scan includes " + source.string());
+  static const std::regex include_re(
+      R"(^\s*#\s*include\s*([<"])([^>"]+)[>"])");
+
+  std::set<std::string> seen;
+  std::vector<fs::path> queue = {source.lexically_normal()};
+  std::vector<std::string> found;
 
-  for (const auto &entry : fs::recursive_directory_iterator(config.include)) {
-    if (entry.is_regular_file() && entry.path().extension() == ".h") {
-      std::string file_hash = hash_file_contents(entry.path());
-      SHA256_Update(&sha_context, file_hash.c_str(), file_hash.size());
+  while (!queue.empty()) {
+    fs::path file = queue.back();
+    queue.pop_back();
+
+    std::ifstream in(file);
+    std::string line;
+    std::smatch match;
+    while (std::getline(in, line)) {
+      if (line.find("include") == std::string::npos ||
+          !std::regex_search(line, match, include_re))
+        continue;
+
+      std::vector<fs::path> candidates;
+      if (match[1] == "\"")
+        candidates.push_back(file.parent_path() / match[2].str());
+      for (const auto &dir : include_dirs)
+        candidates.push_back(fs::path(dir) / match[2].str());
+
+      for (const auto &candidate : candidates) {
+        std::error_code ec;
+        if (!fs::is_regular_file(candidate, ec))
+          continue;
+        fs::path resolved = candidate.lexically_normal();
+        if (seen.insert(resolved.string()).second) {
+          found.push_back(resolved.string());
+          if (!inside_zyn(resolved))
+            queue.push_back(resolved);
+        }
+        break;
+      }
     }
   }
 
-  unsigned char hash[SHA256_DIGEST_LENGTH];
-  SHA256_Final(hash, &sha_context);
+  return found;
+}
+
+std::string hash_inputs(const std::vector<std::string> &inputs) {
+  std::string digest;
+  digest.reserve(inputs.size() * 64);
 
-  std::stringstream ss;
-  for (unsigned char byte : hash) {
-    ss << std::hex << std::setw(2) << std::setfill('0')
-       << static_cast<int>(byte);
+  for (const auto &input : inputs) {
+    std::string file_hash = file_state().hash(input);
+    if (file_hash.empty())
+      return {};
+    digest += input;
+    digest.push_back('\0');
+    digest += file_hash;
   }
 
-  return ss.str();
+  return utils::fast_hash(digest);
 }
 
-bool needs_rebuild(const Config &config) {
-  fs::path cache_dir = ".zyn/cache";
-  fs::path hash_file = cache_dir / "source_hashes.txt";
-  fs::path executable = ".zyn/build/" + config.name;
+BuildRecord load_build_record(const BuildPlan &plan) {
+  BuildRecord record;
+  std::ifstream in(plan.cache_dir / "deps.db", std::ios::binary);
+  if (!in)
+    return record;
 
-  if (!fs::exists(executable)) {
-    return true;
+  char magic[sizeof(deps_db_magic)];
+  if (!in.read(magic, sizeof(magic)) ||
+      !std::equal(magic, magic + sizeof(magic), deps_db_magic))
+    return record;
+
+  uint32_t path_count;
+  if (!utils::read_u32(in, path_count) || path_count > (1u << 24))
+    return {};
+  std::vector<std::string> paths(path_count);
+  for (auto &path : paths) {
+    if (!utils::read_str(in, path))
+      return {};
   }
 
-  if (!fs::exists(hash_file)) {
-    return true;
+  uint32_t object_count;
+  if (!utils::read_str(in, record.link_hash) ||
+      !utils::read_u32(in, object_count))
+    return {};
+
+  for (uint32_t i = 0; i < object_count; ++i) {
+    std::string object_path;
+    ObjectRecord object;
+    uint32_t input_count;
+    if (!utils::read_str(in, object_path) ||
+        !utils::read_str(in, object.command_hash) ||
+        !utils::read_str(in, object.inputs_hash) ||
+        !utils::read_u32(in, input_count))
+      return {};
+
+    object.inputs.reserve(input_count);
+    for (uint32_t j = 0; j < input_count; ++j) {
+      uint32_t index;
+      if (!utils::read_u32(in, index) || index >= paths.size())
+        return {};
+      object.inputs.push_back(paths[index]);
+    }
+    record.objects[object_path] = std::move(object);
   }
 
-  std::ifstream in(hash_file);
-  std::string stored_hash;
-  std::getline(in, stored_hash);
+  return record;
+}
 
-  std::string current_hash = hash_source_files(config);
+std::vector<const CompileUnit *> stale_units(const BuildPlan &plan,
+                                             const BuildRecord &stored) {
+  utils::TraceScope trace("hash", "check objects");
+  std::vector<const CompileUnit *> stale;
+  std::vector<std::string> inputs;
 
-  if (stored_hash != current_hash) {
-    return true;
+  for (const auto &unit : plan.units) {
+    auto it = stored.objects.find(unit.object.string());
+    if (it != stored.objects.end())
+      inputs.insert(inputs.end(), it->second.inputs.begin(),
+                    it->second.inputs.end());
   }
+  std::sort(inputs.begin(), inputs.end());
+  inputs.erase(std::unique(inputs.begin(), inputs.end()), inputs.end());
+  file_state().prefetch(inputs);
+  for (const auto &unit : plan.units) {
+    auto it = stored.objects.find(unit.object.string());
 
-  auto executable_time = fs::last_write_time(executable);
-  for (const auto &[name, dep] : config.dependencies) {
-    if (!dep.path.empty()) {
-      fs::path dep_path = dep.path;
-      if (fs::is_directory(dep_path)) {
-        for (const auto &entry : fs::recursive_directory_iterator(dep_path)) {
-          if (entry.is_regular_file() &&
-              (entry.path().extension() == ".h" ||
-               entry.path().extension() == ".cpp" ||
-               entry.path().filename() == "CMakeLists.txt")) {
-            if (fs::last_write_time(entry) > executable_time) {
-              return true;
-            }
-          }
-        }
-      }
+    if (it == stored.objects.end() || !fs::exists(unit.object) ||
+        it->second.command_hash != hash_string(unit.command) ||
+        it->second.inputs_hash != hash_inputs(it->second.inputs)) {
+      stale.push_back(&unit);
     }
   }
 
-  return false;
+  return stale;
 }
 
-void update_cache(const Config &config) {
-  fs::path cache_dir = ".zyn/cache";
+void record_objects(const std::vector<const CompileUnit *> &built,
+                    BuildRecord &record) {
+  utils::TraceScope trace("hash", "record objects");
+  std::vector<ObjectRecord> objects(built.size());
+  std::vector<std::string> inputs;
+
+  for (size_t i = 0; i < built.size(); ++i) {
+    objects[i].command_hash = hash_string(built[i]->command);
+    objects[i].inputs = parse_depfile(built[i]->depfile);
+    inputs.insert(inputs.end(), objects[i].inputs.begin(),
+                  objects[i].inputs.end());
+  }
+  std::sort(inputs.begin(), inputs.end());
+  inputs.erase(std::unique(inputs.begin(), inputs.end()), inputs.end());
+  file_state().prefetch(inputs);
+
+  for (size_t i = 0; i < built.size(); ++i) {
+    objects[i].inputs_hash = hash_inputs(objects[i].inputs);
+    record.objects[built[i]->object.string()] = std::move(objects[i]);
+  }
+}
+
+std::string link_hash(const BuildPlan &plan) {
+  std::string digest = plan.link_cmd;
+  for (const auto &input : plan.link_inputs) {
+    digest.push_back('\0');
+    digest += file_state().hash(input);
+  }
+  return hash_string(digest);
+}
+
+bool needs_link(const BuildPlan &plan, const BuildRecord &stored) {
+  return !fs::exists(plan.output) || stored.link_hash != link_hash(plan);
+}
+
+void save_build_record(const BuildPlan &plan, const BuildRecord &record) {
+  const fs::path &cache_dir = plan.cache_dir;
   fs::create_directories(cache_dir);
 
-  std::string current_hash = hash_source_files(config);
-  std::ofstream out(cache_dir / "source_hashes.txt");
-  out << current_hash;
+  std::vector<const std::string *> paths;
+  std::unordered_map<std::string, uint32_t> path_index;
+  for (const auto &[_, object] : record.objects) {
+    for (const auto &input : object.inputs) {
+      if (path_index.emplace(input, static_cast<uint32_t>(paths.size()))
+              .second)
+        paths.push_back(&input);
+    }
+  }
+
+  fs::path tmp = cache_dir / "deps.db.tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(deps_db_magic, sizeof(deps_db_magic));
+
+    utils::write_u32(out, static_cast<uint32_t>(paths.size()));
+    for (const std::string *path : paths)
+      utils::write_str(out, *path);
+
+    utils::write_str(out, record.link_hash);
+    utils::write_u32(out, static_cast<uint32_t>(record.objects.size()));
+    for (const auto &[object_path, object] : record.objects) {
+      utils::write_str(out, object_path);
+      utils::write_str(out, object.command_hash);
+      utils::write_str(out, object.inputs_hash);
+      utils::write_u32(out, static_cast<uint32_t>(object.inputs.size()));
+      for (const auto &input : object.inputs)
+        utils::write_u32(out, path_index.at(input));
+    }
+  }
+  fs::rename(tmp, cache_dir / "deps.db");
 }
 
-} // namespace project_management
\ No newline at end of file
+} // namespace project_management
@@ -0,0 +1,443 @@
+#include "../include/project_management/bench.hpp"
+#include "../include/dependency_manager/git_dependency.hpp"
+#include "../include/dependency_manager/install_pipeline.hpp"
+#include "../include/project_management/assembly_cache.hpp"
+#include "../include/project_management/compile_cmd_generator.hpp"
+#include "../include/project_management/file_state.hpp"
+#include "../include/project_management/runner.hpp"
+#include "../include/utils/jobserver.hpp"
+#include "../include/utils/thread_pool.hpp"
+#include "../include/utils/trace.hpp"
+#include "../include/utils/utils.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <numeric>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace project_management {
+
+using json = nlohmann::json;
+
+// Two-sided 95% quantiles of Student's t distribution by degrees of freedom.
+static double t95(double df) {
+  static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447,
+                                 2.365,  2.306, 2.262, 2.228, 2.201, 2.179,
+                                 2.160,  2.145, 2.131, 2.120, 2.110, 2.101,
+                                 2.093,  2.086, 2.080, 2.074, 2.069, 2.064,
+                                 2.060,  2.056, 2.052, 2.048, 2.045, 2.042};
+  if (df < 1)
+    return table[0];
+  if (df <= 30)
+    return table[static_cast<size_t>(df) - 1];
+  return df <= 60 ? 2.000 : df <= 120 ? 1.980 : 1.960;
+}
+
+BenchStats bench_stats(const std::string &name,
+                       const std::vector<double> &samples) {
+  BenchStats stats;
+  stats.name = name;
+  stats.samples = samples;
+  if (samples.empty())
+    return stats;
+
+  std::vector<double> sorted = samples;
+  std::sort(sorted.begin(), sorted.end());
+  const size_t n = sorted.size();
+  stats.min = sorted.front();
+  stats.median =
+      n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+  stats.mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / n;
+  if (n > 1) {
+    double squares = 0;
+    for (double sample : sorted)
+      squares += (sample - stats.mean) * (sample - stats.mean);
+    stats.stddev = std::sqrt(squares / (n - 1));
+    stats.ci95 = t95(n - 1) * stats.stddev / std::sqrt(double(n));
+  }
+  return stats;
+}
+
+static std::string trim(std::string text) {
+  text.erase(text.find_last_not_of(" \t\r\n") + 1);
+  return text;
+}
+
+static std::string git_revision(const std::string &rev) {
+  utils::ProcessResult result =
+      utils::run_captured("git rev-parse --short " + rev + " 2>/dev/null");
+  return result.exit_code == 0 ? trim(result.output) : std::string();
+}
+
+std::string bench_revision() {
+  std::string rev = git_revision("HEAD");
+  if (rev.empty())
+    return "worktree";
+  if (!trim(utils::run_captured("git status --porcelain 2>/dev/null").output)
+           .empty())
+    rev += "-dirty";
+  return rev;
+}
+
+static bool defines_main(const fs::path &source) {
+  static const std::regex main_re(R"(\bint\s+main\s*\()");
+  std::ifstream in(source);
+  std::stringstream content;
+  content << in.rdbuf();
+  return std::regex_search(content.str(), main_re);
+}
+
+static bool newer_than(const fs::path &output,
+                       const std::vector<fs::path> &inputs) {
+  std::error_code ec;
+  auto built = fs::last_write_time(output, ec);
+  if (ec)
+    return true;
+  return std::any_of(inputs.begin(), inputs.end(), [&](const fs::path &in) {
+    return fs::last_write_time(in, ec) > built || ec;
+  });
+}
+
+std::vector<fs::path> build_benchmarks(const Config &cfg,
+                                       const std::string &profile,
+                                       unsigned jobs) {
+  const BuildPlan project =
+      generate_compile_cmd(cfg, profile, profile_flags(cfg, profile));
+
+  // Benchmarks link against the project's objects except its entry point.
+  std::vector<fs::path> objects;
+  for (const auto &unit : project.units) {
+    if (!defines_main(unit.source))
+      objects.push_back(unit.object);
+  }
+
+  BuildPlan plan;
+  plan.profile_key = project.profile_key;
+  plan.build_dir = fs::path(".zyn/build/bench") / project.profile_key;
+  plan.cache_dir = fs::path(".zyn/cache/bench") / project.profile_key;
+
+  std::vector<fs::path> sources;
+  for (const auto &entry : fs::recursive_directory_iterator(cfg.bench)) {
+    if (entry.is_regular_file() &&
+        entry.path().extension() == "." + cfg.language)
+      sources.push_back(entry.path());
+  }
+  std::sort(sources.begin(), sources.end());
+
+  for (const auto &source : sources) {
+    CompileUnit unit;
+    unit.source = source;
+    unit.object =
+        plan.build_dir / "obj" / (source.relative_path().string() + ".o");
+    unit.depfile = unit.object.string() + ".d";
+    unit.identity = cfg.compiler + project.compile_flags + " -I" + cfg.bench +
+                    " -c " + source.string();
+    unit.command = unit.identity + " -o " + unit.object.string() +
+                   " -MMD -MF " + unit.depfile.string();
+    plan.units.push_back(std::move(unit));
+  }
+
+  BuildRecord stored = load_build_record(plan);
+  std::vector<const CompileUnit *> stale = stale_units(plan, stored);
+  BuildRecord next;
+  for (const auto &unit : plan.units) {
+    const std::string key = unit.object.string();
+    if (std::find(stale.begin(), stale.end(), &unit) == stale.end())
+      next.objects[key] = stored.objects.at(key);
+  }
+
+  std::atomic<bool> failed{false};
+  std::vector<char> built_flags(stale.size(), 0);
+  {
+    utils::ThreadPool pool(
+        std::max(1u, std::min<unsigned>(jobs, stale.size())), "bench");
+    std::vector<std::future<void>> compiles;
+    for (size_t i = 0; i < stale.size(); ++i) {
+      compiles.push_back(pool.submit([&, i]() {
+        const CompileUnit *unit = stale[i];
+        fs::create_directories(unit->object.parent_path());
+        utils::TraceScope trace("compile", unit->source.string());
+        utils::ProcessResult result;
+        {
+          utils::Jobserver::Token token(
+              dependency_manager::shared_jobserver(jobs));
+          result = utils::run_captured(unit->command);
+        }
+        std::cout << "Running: " + unit->command + "\n" + result.output;
+        if (result.exit_code != 0)
+          failed = true;
+        else
+          built_flags[i] = 1;
+      }));
+    }
+    for (auto &compile : compiles)
+      compile.get();
+  }
+
+  std::vector<const CompileUnit *> built;
+  for (size_t i = 0; i < stale.size(); ++i) {
+    if (built_flags[i])
+      built.push_back(stale[i]);
+  }
+  record_objects(built, next);
+  save_build_record(plan, next);
+  if (failed)
+    throw std::runtime_error("Benchmark compilation failed");
+
+  std::vector<fs::path> executables;
+  for (const auto &unit : plan.units) {
+    fs::path executable = plan.build_dir / unit.source.stem();
+    std::vector<fs::path> inputs = {unit.object};
+    inputs.insert(inputs.end(), objects.begin(), objects.end());
+
+    std::vector<fs::path> link_inputs = inputs;
+    link_inputs.insert(link_inputs.end(), project.link_inputs.begin(),
+                       project.link_inputs.end());
+    if (newer_than(executable, link_inputs)) {
+      std::string link = cfg.compiler;
+      for (const auto &input : inputs)
+        link += " " + input.string();
+      link += " -o " + executable.string() + project.link_flags;
+
+      utils::TraceScope trace("link", executable.string());
+      if (run_command(link) != 0)
+        throw std::runtime_error("Benchmark link failed: " +
+                                 executable.string());
+    }
+    executables.push_back(executable);
+  }
+  return executables;
+}
+
+static std::string read_line(const fs::path &path) {
+  std::ifstream in(path);
+  std::string line;
+  std::getline(in, line);
+  return trim(line);
+}
+
+static void pin_cpu(int cpu) {
+  if (cpu < 0)
+    return;
+#ifdef __linux__
+  // Benchmarks are children of zyn and inherit its affinity.
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (sched_setaffinity(0, sizeof(set), &set) != 0)
+    std::cerr << "[Zyn] Could not pin benchmarks to CPU " << cpu << "\n";
+#else
+  std::cerr << "[Zyn] CPU pinning is only supported on Linux.\n";
+#endif
+}
+
+static json frequency_settings(int cpu) {
+  const fs::path cpufreq = fs::path("/sys/devices/system/cpu") /
+                           ("cpu" + std::to_string(cpu < 0 ? 0 : cpu)) /
+                           "cpufreq";
+  json settings = json::object();
+
+  const std::string governor = read_line(cpufreq / "scaling_governor");
+  if (!governor.empty()) {
+    settings["governor"] = governor;
+    if (governor != "performance")
+      std::cerr << "[Zyn] Warning: CPU frequency governor is '" << governor
+                << "', results may be noisy (use 'performance').\n";
+  }
+
+  const std::string no_turbo =
+      read_line("/sys/devices/system/cpu/intel_pstate/no_turbo");
+  const std::string boost = read_line("/sys/devices/system/cpu/cpufreq/boost");
+  if (no_turbo == "0" || boost == "1") {
+    settings["turbo"] = true;
+    std::cerr << "[Zyn] Warning: turbo boost is enabled, results depend on "
+                 "temperature and load.\n";
+  } else if (!no_turbo.empty() || !boost.empty()) {
+    settings["turbo"] = false;
+  }
+  return settings;
+}
+
+static double current_frequency(int cpu) {
+  const std::string khz =
+      read_line(fs::path("/sys/devices/system/cpu") /
+                ("cpu" + std::to_string(cpu < 0 ? 0 : cpu)) / "cpufreq" /
+                "scaling_cur_freq");
+  return khz.empty() ? 0 : std::stod(khz) / 1000;
+}
+
+static json to_json(const BenchStats &stats) {
+  return {{"name", stats.name},     {"samples", stats.samples},
+          {"min", stats.min},       {"median", stats.median},
+          {"mean", stats.mean},     {"stddev", stats.stddev},
+          {"ci95", stats.ci95}};
+}
+
+static fs::path baseline_path(const std::string &baseline) {
+  fs::path path = fs::path(".zyn/bench") / (baseline + ".json");
+  if (fs::exists(path))
+    return path;
+  std::string rev = git_revision(baseline);
+  if (!rev.empty() && fs::exists(fs::path(".zyn/bench") / (rev + ".json")))
+    return fs::path(".zyn/bench") / (rev + ".json");
+  throw std::runtime_error("No benchmark results for baseline '" + baseline +
+                           "' in .zyn/bench");
+}
+
+static void compare(const std::vector<BenchStats> &results,
+                    const std::string &baseline) {
+  const fs::path path = baseline_path(baseline);
+  std::ifstream in(path);
+  json base = json::parse(in);
+
+  std::cout << "\nCompared with " << base.value("revision", baseline)
+            << " (mean, 95% confidence interval):\n";
+  for (const auto &current : results) {
+    auto it = std::find_if(
+        base["results"].begin(), base["results"].end(),
+        [&](const json &entry) { return entry["name"] == current.name; });
+    if (it == base["results"].end()) {
+      std::cout << "  " << current.name << ": new benchmark\n";
+      continue;
+    }
+
+    BenchStats old =
+        bench_stats(current.name, (*it)["samples"].get<std::vector<double>>());
+    const double n1 = current.samples.size(), n2 = old.samples.size();
+    const double v1 = current.stddev * current.stddev / n1;
+    const double v2 = old.stddev * old.stddev / n2;
+    const double se = std::sqrt(v1 + v2);
+    // Welch-Satterthwaite degrees of freedom for unequal variances.
+    const double df = se > 0 ? (v1 + v2) * (v1 + v2) /
+                                   (v1 * v1 / (n1 - 1) + v2 * v2 / (n2 - 1))
+                             : n1 + n2 - 2;
+    const double diff = current.mean - old.mean;
+    const double half = t95(df) * se;
+
+    std::cout << std::fixed << std::setprecision(1) << "  " << current.name
+              << ": " << (diff >= 0 ? "+" : "") << 100 * diff / old.mean
+              << "% +/- " << 100 * half / old.mean << "% ("
+              << std::setprecision(6) << old.mean << "s -> " << current.mean
+              << "s) "
+              << (std::abs(diff) <= half ? "no significant change"
+                  : diff < 0             ? "faster"
+                                         : "slower")
+              << "\n";
+  }
+}
+
+void bench(const BenchOptions &bench_options) {
+  Config cfg = parse("zyn.toml");
+  if (!fs::is_directory(cfg.bench))
+    throw std::runtime_error("Benchmark directory '" + cfg.bench +
+                             "' not found");
+
+  RunOptions options;
+  options.profile =
+      bench_options.profile.empty() ? cfg.bench_profile : bench_options.profile;
+  options.jobs = bench_options.jobs;
+  const unsigned warmup = bench_options.warmup >= 0
+                              ? static_cast<unsigned>(bench_options.warmup)
+                              : cfg.bench_warmup;
+  const unsigned repeat = bench_options.repeat >= 2
+                              ? static_cast<unsigned>(bench_options.repeat)
+                              : cfg.bench_repeat;
+  const int cpu = bench_options.cpu >= 0 ? bench_options.cpu : cfg.bench_cpu;
+  const std::string baseline = bench_options.baseline.empty()
+                                   ? cfg.bench_baseline
+                                   : bench_options.baseline;
+
+  const unsigned jobs = resolve_jobs(cfg, options);
+  dependency_manager::InstallPipeline pipeline(
+      dependency_manager::make_build_variant(cfg, options.profile, jobs),
+      dependency_manager::pipeline_limits(jobs));
+  for (const auto &[name, dep] : dependency_manager::git_dependencies(cfg))
+    pipeline.add(name, dep);
+  if (!build(cfg, options, &pipeline))
+    return;
+
+  std::vector<fs::path> executables =
+      build_benchmarks(cfg, options.profile, jobs);
+  save_file_state();
+
+  pin_cpu(cpu);
+  json out = {{"revision", bench_revision()},
+              {"profile", options.profile},
+              {"compiler", cfg.compiler},
+              {"warmup", warmup},
+              {"repeat", repeat},
+              {"cpu", cpu},
+              {"frequency", frequency_settings(cpu)},
+              {"results", json::array()}};
+
+  std::vector<BenchStats> results;
+  for (const auto &executable : executables) {
+    const std::string name = executable.filename().string();
+    if (name.find(bench_options.filter) == std::string::npos)
+      continue;
+
+    std::cout << "[Zyn] Benchmarking " << name << " (" << warmup
+              << " warmup, " << repeat << " runs)...\n";
+    std::vector<double> samples;
+    std::string output;
+    double min_mhz = 0, max_mhz = 0;
+    for (unsigned i = 0; i < warmup + repeat; ++i) {
+      utils::TraceScope trace("bench", name);
+      auto start = std::chrono::steady_clock::now();
+      utils::ProcessResult result = utils::run_captured(executable.string());
+      auto end = std::chrono::steady_clock::now();
+      if (result.exit_code != 0) {
+        std::cerr << result.output;
+        throw std::runtime_error("Benchmark " + name + " failed with code " +
+                                 std::to_string(result.exit_code));
+      }
+      if (i < warmup)
+        continue;
+
+      output = result.output;
+      samples.push_back(std::chrono::duration<double>(end - start).count());
+      const double mhz = current_frequency(cpu);
+      min_mhz = min_mhz == 0 ? mhz : std::min(min_mhz, mhz);
+      max_mhz = std::max(max_mhz, mhz);
+    }
+
+    BenchStats stats = bench_stats(name, samples);
+    json entry = to_json(stats);
+    if (max_mhz > 0) {
+      entry["mhz"] = {min_mhz, max_mhz};
+      if (max_mhz > min_mhz * 1.1)
+        std::cerr << "[Zyn] Warning: CPU frequency varied between "
+                  << min_mhz << " and " << max_mhz << " MHz during " << name
+                  << ".\n";
+    }
+    out["results"].push_back(entry);
+
+    std::cout << std::fixed << std::setprecision(6) << "  mean " << stats.mean
+              << "s +/- " << stats.ci95 << "s, median " << stats.median
+              << "s, min " << stats.min << "s\n"
+              << output;
+    results.push_back(std::move(stats));
+  }
+
+  const fs::path output =
+      fs::path(".zyn/bench") / (out["revision"].get<std::string>() + ".json");
+  fs::create_directories(output.parent_path());
+  std::ofstream(output) << out.dump(2) << "\n";
+  std::cout << "[Zyn] Results written to " << output.string() << "\n";
+
+  if (!baseline.empty())
+    compare(results, baseline);
+}
+
+} // namespace project_management
@@ -0,0 +1,183 @@
+#include "../include/project_management/bolt.hpp"
+#include "../include/project_management/assembly_cache.hpp"
+#include "../include/project_management/file_state.hpp"
+#include "../include/project_management/pgo.hpp"
+#include "../include/utils/trace.hpp"
+#include "../include/utils/utils.hpp"
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace project_management {
+
+static const char *bolt_flags =
+    " -reorder-blocks=ext-tsp -reorder-functions=hfsort -split-functions"
+    " -split-all-cold -split-eh -dyno-stats";
+
+fs::path bolt_dir(const fs::path &binary) {
+  return fs::path(".zyn/bolt") / binary.parent_path().filename();
+}
+
+static bool has_tool(const std::string &tool) {
+  return utils::run_captured("command -v " + tool).exit_code == 0;
+}
+
+// Sampling with branch records needs LBR (or an equivalent) in the CPU and a
+// permissive perf_event_paranoid; without it BOLT instruments the binary.
+static bool perf_has_branch_records(const fs::path &dir) {
+  if (!has_tool("perf") || !has_tool("perf2bolt"))
+    return false;
+  const fs::path probe = dir / "probe.data";
+  bool ok = utils::run_captured("perf record -e cycles:u -j any,u -o \"" +
+                                probe.string() + "\" -- true")
+                .exit_code == 0;
+  std::error_code ec;
+  fs::remove(probe, ec);
+  return ok;
+}
+
+static std::vector<std::string> training_runs(const Config &cfg) {
+  std::vector<std::string> runs = cfg.pgo_training;
+  if (runs.empty())
+    runs.emplace_back();
+  return runs;
+}
+
+static bool collect_profile(const Config &cfg, const fs::path &binary,
+                            const fs::path &raw) {
+  const fs::path dir = raw.parent_path();
+  const std::vector<std::string> runs = training_runs(cfg);
+
+  if (perf_has_branch_records(dir)) {
+    std::cout << "[Zyn] BOLT: sampling training workload with perf...\n";
+    for (size_t i = 0; i < runs.size(); ++i) {
+      const fs::path data = dir / ("perf-" + std::to_string(i) + ".data");
+      std::string cmd = "perf record -e cycles:u -j any,u -o \"" +
+                        data.string() + "\" -- " + binary.string();
+      if (!runs[i].empty())
+        cmd += " " + runs[i];
+
+      utils::TraceScope trace("bolt", "train " + runs[i]);
+      if (run_command(cmd) != 0 ||
+          run_command("perf2bolt -p \"" + data.string() + "\" -o \"" +
+                      (raw / (std::to_string(i) + ".fdata")).string() +
+                      "\" " + binary.string()) != 0) {
+        std::cerr << "[Zyn] Training run failed: " << cmd << "\n";
+        return false;
+      }
+      fs::remove(data);
+    }
+    return true;
+  }
+
+  std::cout << "[Zyn] BOLT: perf branch sampling unavailable, "
+               "instrumenting binary...\n";
+  const fs::path instrumented = dir / "instrumented";
+  {
+    utils::TraceScope trace("bolt", "llvm-bolt -instrument");
+    if (run_command("llvm-bolt " + binary.string() + " -instrument -o \"" +
+                    instrumented.string() + "\" --instrumentation-file=\"" +
+                    (raw / "prof").string() +
+                    "\" --instrumentation-file-append-pid") != 0) {
+      std::cerr << "[Zyn] Could not instrument binary with llvm-bolt.\n";
+      return false;
+    }
+  }
+
+  bool ok = true;
+  for (const auto &args : runs) {
+    std::string cmd = instrumented.string();
+    if (!args.empty())
+      cmd += " " + args;
+
+    utils::TraceScope trace("bolt", "train " + args);
+    if (run_command(cmd) != 0) {
+      std::cerr << "[Zyn] Training run failed: " << cmd << "\n";
+      ok = false;
+    }
+  }
+  fs::remove(instrumented);
+  return ok;
+}
+
+static bool merge_profiles(const fs::path &raw, const fs::path &profile) {
+  std::string merge = "merge-fdata";
+  for (const auto &entry : fs::directory_iterator(raw)) {
+    if (entry.path().extension() == ".fdata")
+      merge += " \"" + entry.path().string() + "\"";
+  }
+  merge += " > \"" + profile.string() + "\"";
+
+  utils::TraceScope trace("bolt", "merge-fdata");
+  if (run_command(merge) != 0) {
+    std::cerr << "[Zyn] Could not merge profiles with merge-fdata.\n";
+    return false;
+  }
+  return true;
+}
+
+bool bolt_build(const Config &cfg, const RunOptions &options,
+                dependency_manager::InstallPipeline *pipeline) {
+  // BOLT rewrites functions in place only when the static relocations survive
+  // the link.
+  RunOptions relocs = options;
+  relocs.bolt = false;
+  relocs.link_flags.push_back("-Wl,--emit-relocs");
+  if (!(options.pgo ? pgo_build(cfg, relocs, pipeline)
+                    : build(cfg, relocs, pipeline)))
+    return false;
+
+  if (!has_tool("llvm-bolt") || !has_tool("merge-fdata")) {
+    std::cerr << "[Zyn] BOLT needs llvm-bolt and merge-fdata on PATH.\n";
+    return false;
+  }
+
+  BuildPlan plan;
+  plan.published = fs::path(".zyn/build") / cfg.name;
+  const fs::path binary =
+      plan.published.parent_path() / fs::read_symlink(plan.published);
+  const fs::path dir = bolt_dir(binary);
+  const fs::path raw = dir / "raw";
+  const fs::path profile = dir / "profile.fdata";
+  plan.output = dir / cfg.name;
+
+  std::string identity = file_state().hash(binary.string());
+  identity += '\0' + std::string(bolt_flags);
+  for (const auto &args : cfg.pgo_training)
+    identity += '\0' + args;
+  const std::string stamp = hash_string(identity);
+
+  std::ifstream stamp_file(dir / "stamp");
+  std::string stored;
+  std::getline(stamp_file, stored);
+  stamp_file.close();
+  if (stored == stamp && fs::exists(plan.output)) {
+    std::cout << "[Zyn] BOLT: binary unchanged, reusing "
+              << plan.output.string() << "\n";
+    publish_output(plan);
+    return true;
+  }
+
+  fs::remove_all(dir);
+  fs::create_directories(raw);
+  if (!collect_profile(cfg, binary, raw) || !merge_profiles(raw, profile))
+    return false;
+
+  std::cout << "[Zyn] BOLT: optimizing binary layout...\n";
+  {
+    utils::TraceScope trace("bolt", "llvm-bolt");
+    if (run_command("llvm-bolt " + binary.string() + " -o \"" +
+                    plan.output.string() + "\" -data=\"" + profile.string() +
+                    "\"" + bolt_flags) != 0) {
+      std::cerr << "[Zyn] llvm-bolt failed.\n";
+      return false;
+    }
+  }
+  fs::remove_all(raw);
+  std::ofstream(dir / "stamp") << stamp << "\n";
+
+  publish_output(plan);
+  return true;
+}
+
+} // namespace project_management
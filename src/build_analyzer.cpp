@@ -0,0 +1,217 @@
+#include "../include/project_management/build_analyzer.hpp"
+#include "../include/dependency_manager/git_dependency.hpp"
+#include "../include/project_management/compile_cache.hpp"
+#include "../include/project_management/compile_cmd_generator.hpp"
+#include "../include/project_management/parser.hpp"
+#include "../include/utils/thread_pool.hpp"
+#include "../include/utils/utils.hpp"
+#include <algorithm>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <regex>
+#include <sstream>
+#include <vector>
+
+namespace project_management {
+
+using json = nlohmann::json;
+
+static void add_time(std::map<std::string, TimeEntry> &entries,
+                     const std::string &name, double ms) {
+  TimeEntry &entry = entries[name];
+  entry.total_ms += ms;
+  ++entry.count;
+}
+
+bool read_time_trace(const fs::path &path, const std::string &unit,
+                     BuildAnalysis &analysis) {
+  std::ifstream in(path);
+  if (!in)
+    return false;
+
+  json trace = json::parse(in, nullptr, false);
+  if (trace.is_discarded() || !trace.contains("traceEvents"))
+    return false;
+
+  for (const auto &event : trace["traceEvents"]) {
+    if (event.value("ph", "") != "X")
+      continue;
+
+    const std::string name = event.value("name", "");
+    const double ms = event.value("dur", 0.0) / 1000.0;
+    std::string detail;
+    if (event.contains("args") && event["args"].contains("detail"))
+      detail = event["args"]["detail"].get<std::string>();
+
+    if (name == "Source") {
+      add_time(analysis.headers, fs::path(detail).lexically_normal().string(),
+               ms);
+    } else if (name == "InstantiateClass" || name == "InstantiateFunction") {
+      add_time(analysis.templates, detail, ms);
+    } else if (name == "Total ExecuteCompiler") {
+      add_time(analysis.units, unit, ms);
+    } else if (name.rfind("Total ", 0) == 0) {
+      add_time(analysis.phases, name.substr(6), ms);
+    }
+  }
+
+  return true;
+}
+
+bool read_time_report(const std::string &output, const std::string &unit,
+                      BuildAnalysis &analysis) {
+  // name : usr ( n%) sys ( n%) wall ( n%) GGC ( n%)
+  static const std::regex phase_re(R"(^\s*(\S.*?)\s*:\s*)"
+                                   R"([\d.]+\s*\(\s*\d+%\)\s*)"
+                                   R"([\d.]+\s*\(\s*\d+%\)\s*([\d.]+))");
+  static const std::regex total_re(
+      R"(^\s*TOTAL\s*:\s*[\d.]+\s+[\d.]+\s+([\d.]+))");
+
+  std::istringstream in(output);
+  std::string line;
+  std::smatch match;
+  bool found = false;
+  while (std::getline(in, line)) {
+    if (std::regex_search(line, match, total_re)) {
+      add_time(analysis.units, unit, std::stod(match[1]) * 1000.0);
+      found = true;
+    } else if (std::regex_search(line, match, phase_re)) {
+      // Only the "phase ..." rows partition the compile; the others are
+      // sub-timers ("|name lookup", "template instantiation") that overlap
+      // them and each other.
+      std::string name = match[1];
+      const double ms = std::stod(match[2]) * 1000.0;
+      if (name.rfind("phase ", 0) == 0) {
+        add_time(analysis.phases, name.substr(6), ms);
+      } else {
+        if (name.front() == '|')
+          name.erase(0, 1);
+        add_time(analysis.timers, name, ms);
+      }
+    }
+  }
+  return found;
+}
+
+static std::vector<std::pair<std::string, TimeEntry>>
+slowest(const std::map<std::string, TimeEntry> &entries, size_t top) {
+  std::vector<std::pair<std::string, TimeEntry>> sorted(entries.begin(),
+                                                        entries.end());
+  std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
+    return a.second.total_ms > b.second.total_ms;
+  });
+  if (sorted.size() > top)
+    sorted.resize(top);
+  return sorted;
+}
+
+static void print_section(const std::string &title,
+                          const std::map<std::string, TimeEntry> &entries,
+                          size_t top) {
+  if (entries.empty())
+    return;
+
+  std::cout << "\n" << title << ":\n";
+  for (const auto &[name, entry] : slowest(entries, top)) {
+    std::string label = name;
+    if (label.size() > 120)
+      label = label.substr(0, 117) + "...";
+    std::cout << std::setw(10) << std::fixed << std::setprecision(1)
+              << entry.total_ms << " ms " << std::setw(6) << entry.count
+              << "x  " << label << "\n";
+  }
+}
+
+static json section_json(const std::map<std::string, TimeEntry> &entries,
+                         size_t top) {
+  json section = json::array();
+  for (const auto &[name, entry] : slowest(entries, top)) {
+    section.push_back(
+        {{"name", name}, {"total_ms", entry.total_ms}, {"count", entry.count}});
+  }
+  return section;
+}
+
+void analyze_build(const RunOptions &options, size_t top) {
+  Config cfg = parse("zyn.toml");
+  const unsigned jobs = resolve_jobs(cfg, options);
+  dependency_manager::install_all_from_config(options.profile, jobs);
+
+  BuildPlan plan = generate_compile_cmd(cfg, options.profile,
+                                        profile_flags(cfg, options.profile));
+
+  const bool clang = is_clang(cfg.compiler);
+  const std::string report_flag = clang ? " -ftime-trace" : " -ftime-report";
+  const fs::path analyze_dir =
+      fs::path(".zyn/build/analyze") / plan.profile_key;
+
+  std::cout << "[Zyn] Compiling " << plan.units.size() << " files with"
+            << report_flag << "...\n";
+
+  BuildAnalysis analysis;
+  std::mutex mutex;
+  size_t failed = 0;
+  {
+    utils::ThreadPool pool(
+        std::min<unsigned>(jobs, static_cast<unsigned>(plan.units.size())),
+        "compile");
+    std::vector<std::future<void>> pending;
+    for (const auto &unit : plan.units) {
+      pending.push_back(pool.submit([&, unit]() {
+        fs::path object =
+            analyze_dir / (unit.source.relative_path().string() + ".o");
+        fs::path trace = object;
+        trace.replace_extension(".json");
+        fs::create_directories(object.parent_path());
+        fs::remove(trace);
+
+        utils::ProcessResult result = utils::run_captured(
+            unit.identity + report_flag + " -o " + object.string());
+
+        std::lock_guard<std::mutex> lock(mutex);
+        const std::string source = unit.source.string();
+        if (result.exit_code != 0) {
+          std::cerr << "Command failed with code " << result.exit_code
+                    << ": " << source << "\n"
+                    << result.output;
+          ++failed;
+        } else if (clang ? !read_time_trace(trace, source, analysis)
+                         : !read_time_report(result.output, source,
+                                             analysis)) {
+          std::cerr << "[Zyn] No timing data for " << source << "\n";
+        }
+      }));
+    }
+    for (auto &job : pending)
+      job.get();
+  }
+
+  print_section("Slowest translation units", analysis.units, top);
+  print_section("Most expensive headers (inclusive parse time)",
+                analysis.headers, top);
+  print_section("Costliest template instantiations", analysis.templates, top);
+  print_section("Compiler phases", analysis.phases, top);
+  print_section("Compiler timers (overlapping, GCC)", analysis.timers, top);
+  if (!clang)
+    std::cout << "\nHeader and template breakdowns need clang "
+                 "(-ftime-trace).\n";
+
+  json report = {{"compiler", cfg.compiler},
+                 {"profile", plan.profile_key},
+                 {"failed", failed},
+                 {"units", section_json(analysis.units, analysis.units.size())},
+                 {"headers", section_json(analysis.headers, top)},
+                 {"templates", section_json(analysis.templates, top)},
+                 {"phases", section_json(analysis.phases, top)},
+                 {"timers", section_json(analysis.timers, top)}};
+  fs::create_directories(analyze_dir);
+  std::ofstream(analyze_dir / "report.json") << report.dump(2) << "\n";
+  std::cout << "\n[Zyn] Report written to "
+            << (analyze_dir / "report.json").string() << "\n";
+}
+
+} // namespace project_management
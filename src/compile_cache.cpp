@@ -0,0 +1,244 @@
+#include "../include/project_management/compile_cache.hpp"
+#include "../include/project_management/assembly_cache.hpp"
+#include "../include/project_management/file_state.hpp"
+#include "../include/utils/hashing.hpp"
+#include "../include/utils/utils.hpp"
+#include <atomic>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+namespace project_management {
+
+static const size_t max_manifest_entries = 16;
+
+struct CacheEntry {
+  std::string object_key;
+  std::vector<std::pair<std::string, std::string>> inputs;
+};
+
+fs::path compile_cache_dir() { return utils::user_cache_dir() / "compile"; }
+
+fs::path sharded(const fs::path &dir, const std::string &key,
+                 const std::string &suffix) {
+  return dir / key.substr(0, 2) / (key + suffix);
+}
+
+fs::path unique_tmp(const fs::path &target) {
+  static std::atomic<unsigned> counter{0};
+  fs::path tmp = target;
+  tmp += ".tmp." + std::to_string(::getpid()) + "." +
+         std::to_string(counter++);
+  return tmp;
+}
+
+bool clone_file(const fs::path &from, const fs::path &to) {
+  fs::create_directories(to.parent_path());
+  fs::path tmp = unique_tmp(to);
+
+#ifdef FICLONE
+  int in = ::open(from.c_str(), O_RDONLY | O_CLOEXEC);
+  if (in >= 0) {
+    int out = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                     0644);
+    bool cloned = out >= 0 && ::ioctl(out, FICLONE, in) == 0;
+    if (out >= 0)
+      ::close(out);
+    ::close(in);
+    if (cloned) {
+      fs::rename(tmp, to);
+      return true;
+    }
+  }
+#endif
+
+  std::error_code ec;
+  fs::copy_file(from, tmp, fs::copy_options::overwrite_existing, ec);
+  if (ec) {
+    fs::remove(tmp, ec);
+    return false;
+  }
+  fs::rename(tmp, to);
+  return true;
+}
+
+std::string compiler_identity(const std::string &compiler) {
+  std::string identity = compiler;
+
+  utils::ProcessResult path = utils::run_captured("command -v " + compiler);
+  std::string resolved = path.output.substr(0, path.output.find('\n'));
+  identity += "\n" + resolved;
+
+  struct stat st;
+  if (!resolved.empty() && ::stat(resolved.c_str(), &st) == 0) {
+    identity += "\n" + std::to_string(st.st_size) + ":" +
+                std::to_string(st.st_mtim.tv_sec);
+  }
+
+  utils::ProcessResult version = utils::run_captured(compiler + " --version");
+  identity += "\n" + version.output;
+
+  return utils::fast_hash(identity);
+}
+
+bool is_clang(const std::string &compiler) {
+  utils::ProcessResult version = utils::run_captured(compiler + " --version");
+  return version.output.find("clang") != std::string::npos;
+}
+
+static bool emits_debug_info(const std::string &identity) {
+  bool debug = false;
+  std::istringstream tokens(identity);
+  for (std::string token; tokens >> token;) {
+    if (token == "-g" || token.rfind("-ggdb", 0) == 0 || token == "-g1" ||
+        token == "-g2" || token == "-g3")
+      debug = true;
+    else if (token == "-g0")
+      debug = false;
+  }
+  return debug;
+}
+
+std::string manifest_key(const CompileUnit &unit,
+                         const std::string &compiler_id) {
+  std::string source_hash = file_state().hash(unit.source.string());
+  if (source_hash.empty())
+    return {};
+  std::string key = compiler_id + '\0' + unit.identity + '\0' + source_hash;
+  // Debug info records the compilation directory (DW_AT_comp_dir), so an
+  // object from another checkout would point the debugger at its sources.
+  if (emits_debug_info(unit.identity))
+    key += '\0' + fs::current_path().string();
+  return utils::fast_hash(key);
+}
+
+std::vector<CacheEntry> read_manifest(const fs::path &path) {
+  std::vector<CacheEntry> entries;
+  std::ifstream in(path);
+  std::string line;
+
+  while (std::getline(in, line)) {
+    std::istringstream header(line);
+    std::string kind;
+    size_t count = 0;
+    CacheEntry entry;
+    header >> kind >> entry.object_key >> count;
+    if (kind != "entry" || entry.object_key.empty())
+      return {};
+
+    for (size_t i = 0; i < count && std::getline(in, line); ++i) {
+      auto space = line.find(' ');
+      if (space == std::string::npos)
+        return {};
+      entry.inputs.emplace_back(line.substr(space + 1), line.substr(0, space));
+    }
+    if (entry.inputs.size() != count)
+      return {};
+    entries.push_back(std::move(entry));
+  }
+
+  return entries;
+}
+
+void write_depfile(const CompileUnit &unit, const CacheEntry &entry) {
+  std::ofstream out(unit.depfile);
+  out << unit.object.string() << ":";
+  for (const auto &[path, _] : entry.inputs) {
+    out << " \\\n ";
+    for (char c : path) {
+      if (c == ' ' || c == '#')
+        out << '\\';
+      if (c == '$')
+        out << '$';
+      out << c;
+    }
+  }
+  out << "\n";
+}
+
+bool restore_object(const CompileUnit &unit, const std::string &compiler_id) {
+  try {
+    std::string key = manifest_key(unit, compiler_id);
+    if (key.empty())
+      return false;
+
+    fs::path root = compile_cache_dir();
+    for (const auto &entry :
+         read_manifest(sharded(root / "manifests", key, ""))) {
+      bool matches = true;
+      for (const auto &[path, hash] : entry.inputs) {
+        if (file_state().hash(path) != hash) {
+          matches = false;
+          break;
+        }
+      }
+      if (!matches)
+        continue;
+
+      fs::path cached = sharded(root / "objects", entry.object_key, ".o");
+      if (!fs::exists(cached) || !clone_file(cached, unit.object))
+        return false;
+      write_depfile(unit, entry);
+      return true;
+    }
+  } catch (const std::exception &) {
+  }
+  return false;
+}
+
+void store_object(const CompileUnit &unit, const std::string &compiler_id) {
+  try {
+    std::string key = manifest_key(unit, compiler_id);
+    if (key.empty())
+      return;
+
+    CacheEntry entry;
+    std::string digest = key;
+    for (const auto &input : parse_depfile(unit.depfile)) {
+      std::string hash = file_state().hash(input);
+      if (hash.empty())
+        return;
+      digest += '\0' + input + '\0' + hash;
+      entry.inputs.emplace_back(input, hash);
+    }
+    entry.object_key = utils::fast_hash(digest);
+
+    fs::path root = compile_cache_dir();
+    fs::path cached = sharded(root / "objects", entry.object_key, ".o");
+    if (!fs::exists(cached) && !clone_file(unit.object, cached))
+      return;
+
+    fs::path manifest = sharded(root / "manifests", key, "");
+    std::vector<CacheEntry> entries = read_manifest(manifest);
+    std::vector<CacheEntry> updated{entry};
+    for (auto &existing : entries) {
+      if (updated.size() >= max_manifest_entries)
+        break;
+      if (existing.object_key != entry.object_key)
+        updated.push_back(std::move(existing));
+    }
+
+    fs::create_directories(manifest.parent_path());
+    fs::path tmp = unique_tmp(manifest);
+    {
+      std::ofstream out(tmp);
+      for (const auto &item : updated) {
+        out << "entry " << item.object_key << " " << item.inputs.size()
+            << "\n";
+        for (const auto &[path, hash] : item.inputs)
+          out << hash << " " << path << "\n";
+      }
+    }
+    fs::rename(tmp, manifest);
+  } catch (const std::exception &) {
+  }
+}
+
+} // namespace project_management
@@ -1,7 +1,14 @@
 #include "../include/project_management/compile_cmd_generator.hpp"
+#include "../include/dependency_manager/dep_usage.hpp"
 #include "../include/dependency_manager/git_dependency.hpp"
+#include "../include/project_management/lto.hpp"
 #include "../include/project_management/parser.hpp"
+#include "../include/utils/hashing.hpp"
+#include "../include/utils/trace.hpp"
+#include <algorithm>
+#include <cctype>
 #include <filesystem>
+#include <map>
 #include <vector>
 #include <sstream>
 
@@ -16,27 +23,70 @@ namespace fs = std::filesystem;
 namespace project_management
 {
 
-  std::stringstream generate_compile_cmd()
+  std::string profile_key(const Config &cfg, const std::string &profile,
+                          const std::vector<std::string> &flags)
   {
-    const project_management::Config cfg = project_management::parse("zyn.toml");
-    std::stringstream cmd;
-
-    cmd << cfg.compiler << " -std=" << cfg.standard;
-
-    for (auto &p : fs::recursive_directory_iterator(cfg.sources))
+    std::string name;
+    for (char c : profile)
     {
-      if (p.is_regular_file() && p.path().extension() == ("." + cfg.language))
+      if (std::isalnum(static_cast<unsigned char>(c)))
+      {
+        name.push_back(c);
+      }
+      else if (!name.empty() && name.back() != '_')
       {
-        cmd << " " << p.path().string();
+        name.push_back('_');
       }
     }
+    if (name.empty())
+    {
+      name = "default";
+    }
 
-    std::string output_path = ".zyn/build/" + cfg.name + EXE_SUFFIX;
-    cmd << " -o " << output_path;
+    std::string identity = cfg.compiler + '\0' + cfg.standard;
+    for (const auto &flag : flags)
+    {
+      identity += '\0' + flag;
+    }
+
+    return name + "-" + utils::fast_hash(identity).substr(0, 8);
+  }
+
+  BuildPlan generate_compile_cmd(const Config &cfg, const std::string &profile,
+                                 const std::vector<std::string> &profile_flags,
+                                 const std::vector<std::string> &stage_flags,
+                                 const std::vector<std::string> &link_flags)
+  {
+    utils::TraceScope trace("plan", "generate build plan");
+    std::vector<std::string> flags = profile_flags;
+    flags.insert(flags.end(), stage_flags.begin(), stage_flags.end());
+
+    // Stage flags (e.g. PGO instrumentation) get their own output tree but
+    // reuse the dependencies built for the plain profile.
+    const std::string usage_key = profile_key(cfg, profile, profile_flags);
+    BuildPlan plan;
+    plan.profile_key = profile_key(cfg, profile, flags);
+    plan.build_dir = fs::path(".zyn/build/profiles") / plan.profile_key;
+    plan.cache_dir = fs::path(".zyn/cache/profiles") / plan.profile_key;
+    plan.output = plan.build_dir / (cfg.name + EXE_SUFFIX);
+    plan.published = fs::path(".zyn/build") / (cfg.name + EXE_SUFFIX);
+
+    LtoFlags lto = lto_flags(cfg, flags);
+    prepare_lto_link(cfg, lto);
+
+    std::stringstream common;
+    common << " -std=" << cfg.standard;
+
+    for (const auto &flag : lto.compile)
+    {
+      common << " " << flag;
+    }
 
-    cmd << " -I" << cfg.include;
+    std::stringstream includes;
+    includes << " -I" << cfg.include;
 
     std::vector<std::string> include_dirs;
+    std::vector<std::string> link_libraries;
     include_dirs.reserve(cfg.dependencies.size() + 2);
 
     for (const auto &[_, dep] : cfg.dependencies)
@@ -47,25 +97,134 @@ namespace project_management
       }
     }
 
-    dependency_manager::find_include_dirs(".zyn/deps", include_dirs);
-    dependency_manager::find_include_dirs(".zyn/build", include_dirs);
+    std::vector<std::string> installed;
+    if (fs::is_directory(".zyn/deps"))
+    {
+      for (const auto &entry : fs::directory_iterator(".zyn/deps"))
+      {
+        if (entry.is_directory())
+        {
+          installed.push_back(entry.path().filename().string());
+        }
+      }
+    }
+    std::sort(installed.begin(), installed.end());
+    plan.dependencies = installed;
+
+    std::map<std::string, dependency_manager::DepUsage> usages;
+    for (const auto &name : installed)
+    {
+      dependency_manager::DepUsage usage;
+      if (!dependency_manager::read_usage(
+              dependency_manager::usage_path(usage_key, name), usage))
+      {
+        dependency_manager::find_include_dirs(".zyn/deps/" + name,
+                                              include_dirs);
+        dependency_manager::find_include_dirs(".zyn/build/" + name,
+                                              include_dirs);
+        continue;
+      }
+
+      include_dirs.insert(include_dirs.end(), usage.include_dirs.begin(),
+                          usage.include_dirs.end());
+      for (const auto &define : usage.defines)
+      {
+        includes << " " << dependency_manager::shell_quote("-D" + define);
+      }
+      usages.emplace(name, std::move(usage));
+    }
+
+    for (const auto &name : dependency_manager::link_order(installed, usages))
+    {
+      const auto &libraries = usages.at(name).link_libraries;
+      link_libraries.insert(link_libraries.end(), libraries.begin(),
+                            libraries.end());
+    }
+
+    plan.include_dirs.push_back(cfg.include);
+    plan.include_dirs.insert(plan.include_dirs.end(), include_dirs.begin(),
+                             include_dirs.end());
 
     for (const auto &dir : include_dirs)
     {
-      cmd << " -I" << dir;
+      includes << " -I" << dir;
+    }
+
+    std::vector<fs::path> sources;
+    {
+      utils::TraceScope scan("scan", "scan " + cfg.sources);
+      for (auto &p : fs::recursive_directory_iterator(cfg.sources))
+      {
+        if (p.is_regular_file() &&
+            p.path().extension() == ("." + cfg.language))
+        {
+          sources.push_back(p.path());
+        }
+      }
+    }
+    std::sort(sources.begin(), sources.end());
+
+    plan.compile_flags = common.str() + includes.str();
+
+    std::stringstream link;
+    link << cfg.compiler;
+
+    for (const auto &source : sources)
+    {
+      CompileUnit unit;
+      unit.source = source;
+      unit.object =
+          plan.build_dir / "obj" / (source.relative_path().string() + ".o");
+      unit.depfile = unit.object.string() + ".d";
+
+      std::stringstream cmd;
+      cmd << cfg.compiler << common.str() << includes.str() << " -c "
+          << source.string();
+      unit.identity = cmd.str();
+      cmd << " -o " << unit.object.string() << " -MMD -MF "
+          << unit.depfile.string();
+      unit.command = cmd.str();
+
+      link << " " << unit.object.string();
+      plan.units.push_back(std::move(unit));
+    }
+
+    link << " -o " << plan.output.string();
+    const size_t link_flags_start = link.str().size();
+    link << common.str();
+
+    for (const auto &flag : lto.link)
+    {
+      link << " " << flag;
+    }
+
+    for (const auto &flag : link_flags)
+    {
+      link << " " << flag;
+    }
+
+    for (const auto &library : link_libraries)
+    {
+      link << " " << library;
+      if (library.front() != '-')
+      {
+        plan.link_inputs.push_back(library);
+      }
     }
 
     for (const auto &lib_dir : cfg.lib_dirs)
     {
-      cmd << " -L" << lib_dir;
+      link << " -L" << lib_dir;
     }
 
     for (const auto &lib : cfg.libraries)
     {
-      cmd << " -l" << lib;
+      link << " -l" << lib;
     }
 
-    return cmd;
+    plan.link_cmd = link.str();
+    plan.link_flags = plan.link_cmd.substr(link_flags_start);
+    return plan;
   }
 
 } // namespace project_management
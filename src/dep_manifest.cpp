@@ -0,0 +1,157 @@
+#include "../include/dependency_manager/dep_manifest.hpp"
+#include "../include/dependency_manager/git_dependency.hpp"
+#include "../include/utils/binary_io.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sys/stat.h>
+#include <vector>
+
+namespace dependency_manager {
+
+static const char manifest_magic[8] = {'Z', 'Y', 'N', 'D', 'M', 'F', '0', '1'};
+
+struct StatEntry {
+  std::string path;
+  uint64_t size = 0;
+  uint64_t mtime_ns = 0;
+  uint64_t inode = 0;
+};
+
+fs::path manifest_path(const std::string &name) {
+  return fs::path(".zyn/cache/deps") / (name + ".manifest");
+}
+
+bool stat_entry(const std::string &path, StatEntry &entry) {
+  struct stat st;
+  if (::stat(path.c_str(), &st) != 0)
+    return false;
+  entry.path = path;
+  entry.size = static_cast<uint64_t>(st.st_size);
+  entry.mtime_ns = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1'000'000'000 +
+                   static_cast<uint64_t>(st.st_mtim.tv_nsec);
+  entry.inode = static_cast<uint64_t>(st.st_ino);
+  return true;
+}
+
+std::string read_first_line(const fs::path &path) {
+  std::ifstream in(path);
+  std::string line;
+  std::getline(in, line);
+  while (!line.empty() && (line.back() == '\r' || line.back() == ' '))
+    line.pop_back();
+  return line;
+}
+
+std::string read_head_commit(const fs::path &repo) {
+  fs::path git_dir = repo / ".git";
+  if (fs::is_regular_file(git_dir)) {
+    std::string line = read_first_line(git_dir);
+    if (line.rfind("gitdir: ", 0) != 0)
+      return {};
+    git_dir = fs::path(line.substr(8));
+    if (git_dir.is_relative())
+      git_dir = repo / git_dir;
+  }
+
+  std::string head = read_first_line(git_dir / "HEAD");
+  if (head.rfind("ref: ", 0) != 0)
+    return head;
+
+  const std::string ref = head.substr(5);
+  fs::path common_dir = git_dir;
+  if (fs::exists(git_dir / "commondir")) {
+    fs::path common = read_first_line(git_dir / "commondir");
+    common_dir = common.is_relative() ? git_dir / common : common;
+  }
+
+  for (const fs::path &dir : {git_dir, common_dir}) {
+    if (fs::exists(dir / ref))
+      return read_first_line(dir / ref);
+  }
+
+  std::ifstream packed(common_dir / "packed-refs");
+  std::string line;
+  while (std::getline(packed, line)) {
+    if (line.size() > 41 && line.compare(41, std::string::npos, ref) == 0)
+      return line.substr(0, 40);
+  }
+  return {};
+}
+
+void write_dep_manifest(const std::string &name, const std::string &source,
+                        const std::string &tag, const std::string &rev,
+                        const std::string &hash, const fs::path &dep_dir) {
+  std::vector<fs::path> dirs;
+  std::vector<fs::path> files = lock_files(dep_dir, &dirs);
+  dirs.push_back(dep_dir);
+
+  std::vector<StatEntry> entries;
+  entries.reserve(files.size() + dirs.size());
+  for (const auto *group : {&files, &dirs}) {
+    for (const auto &path : *group) {
+      StatEntry entry;
+      if (stat_entry(path.string(), entry))
+        entries.push_back(std::move(entry));
+    }
+  }
+
+  fs::path path = manifest_path(name);
+  fs::create_directories(path.parent_path());
+  fs::path tmp = path;
+  tmp += ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(manifest_magic, sizeof(manifest_magic));
+    utils::write_str(out, source);
+    utils::write_str(out, tag);
+    utils::write_str(out, rev);
+    utils::write_str(out, hash);
+    utils::write_u32(out, static_cast<uint32_t>(entries.size()));
+    for (const auto &entry : entries) {
+      utils::write_str(out, entry.path);
+      utils::write_u64(out, entry.size);
+      utils::write_u64(out, entry.mtime_ns);
+      utils::write_u64(out, entry.inode);
+    }
+  }
+  fs::rename(tmp, path);
+}
+
+bool dep_manifest_matches(const std::string &name, const std::string &source,
+                          const std::string &tag, const fs::path &dep_dir) {
+  std::ifstream in(manifest_path(name), std::ios::binary);
+  if (!in)
+    return false;
+
+  char magic[sizeof(manifest_magic)];
+  if (!in.read(magic, sizeof(magic)) ||
+      !std::equal(magic, magic + sizeof(magic), manifest_magic))
+    return false;
+
+  std::string stored_source, stored_tag, rev, hash;
+  uint32_t count;
+  if (!utils::read_str(in, stored_source) || !utils::read_str(in, stored_tag) ||
+      !utils::read_str(in, rev) || !utils::read_str(in, hash) ||
+      !utils::read_u32(in, count))
+    return false;
+
+  if (stored_source != source || stored_tag != tag ||
+      !check_lock(name, rev, hash) || read_head_commit(dep_dir) != rev)
+    return false;
+
+  for (uint32_t i = 0; i < count; ++i) {
+    StatEntry stored, current;
+    if (!utils::read_str(in, stored.path) ||
+        !utils::read_u64(in, stored.size) ||
+        !utils::read_u64(in, stored.mtime_ns) ||
+        !utils::read_u64(in, stored.inode))
+      return false;
+    if (!stat_entry(stored.path, current) || current.size != stored.size ||
+        current.mtime_ns != stored.mtime_ns || current.inode != stored.inode)
+      return false;
+  }
+
+  return true;
+}
+
+} // namespace dependency_manager
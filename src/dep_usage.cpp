@@ -0,0 +1,430 @@
+#include "../include/dependency_manager/dep_usage.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <set>
+
+using json = nlohmann::json;
+
+namespace dependency_manager {
+
+fs::path usage_path(const std::string &profile_key, const std::string &name) {
+  return fs::path(".zyn/cache/profiles") / profile_key / "usage" /
+         (name + ".usage");
+}
+
+void request_codemodel(const fs::path &build) {
+  fs::path query = build / ".cmake/api/v1/query";
+  fs::create_directories(query);
+  std::ofstream(query / "codemodel-v2");
+}
+
+// Injected through CMAKE_PROJECT_INCLUDE: once the top-level CMakeLists.txt
+// has been processed, writes the INTERFACE usage requirements of every
+// library target to .zyn-usage/<target>-<config>.txt, in the format
+// read_usage understands.
+fs::path usage_script(const fs::path &build) {
+  const fs::path script = fs::absolute(build / ".zyn-usage/export.cmake");
+  fs::create_directories(script.parent_path());
+  std::ofstream(script, std::ios::trunc) << R"(include_guard(GLOBAL)
+if(CMAKE_VERSION VERSION_LESS 3.19)
+  return()
+endif()
+
+function(_zyn_targets dir out)
+  get_property(targets DIRECTORY "${dir}" PROPERTY BUILDSYSTEM_TARGETS)
+  get_property(subdirs DIRECTORY "${dir}" PROPERTY SUBDIRECTORIES)
+  foreach(sub IN LISTS subdirs)
+    _zyn_targets("${sub}" nested)
+    list(APPEND targets ${nested})
+  endforeach()
+  set(${out} ${targets} PARENT_SCOPE)
+endfunction()
+
+function(_zyn_links target visited_var out_var)
+  set(visited ${${visited_var}})
+  set(out ${${out_var}})
+  get_target_property(items ${target} INTERFACE_LINK_LIBRARIES)
+  if(NOT items)
+    set(items "")
+  endif()
+  foreach(item IN LISTS items)
+    string(REGEX REPLACE "^\\$<LINK_ONLY:(.*)>$" "\\1" item "${item}")
+    if(item STREQUAL "" OR item MATCHES "^::@")
+      continue()
+    elseif(TARGET "${item}")
+      if("${item}" IN_LIST visited)
+        continue()
+      endif()
+      list(APPEND visited "${item}")
+      get_target_property(type "${item}" TYPE)
+      if(type MATCHES "^(STATIC|SHARED|UNKNOWN)_LIBRARY$")
+        list(APPEND out "link $<TARGET_LINKER_FILE:${item}>")
+      endif()
+      _zyn_links("${item}" visited out)
+    else()
+      list(APPEND out "link ${item}")
+    endif()
+  endforeach()
+  set(${visited_var} ${visited} PARENT_SCOPE)
+  set(${out_var} ${out} PARENT_SCOPE)
+endfunction()
+
+function(_zyn_export_usage)
+  _zyn_targets("${CMAKE_SOURCE_DIR}" targets)
+  foreach(target IN LISTS targets)
+    get_target_property(type ${target} TYPE)
+    if(NOT type MATCHES "^(STATIC|SHARED|OBJECT|INTERFACE)_LIBRARY$")
+      continue()
+    endif()
+    set(lines "")
+    set(visited ${target})
+    if(type MATCHES "^(STATIC|SHARED)_LIBRARY$")
+      list(APPEND lines "link $<TARGET_LINKER_FILE:${target}>")
+    endif()
+    _zyn_links(${target} visited lines)
+    string(JOIN "\n" links ${lines})
+    set(dirs "$<TARGET_PROPERTY:${target},INTERFACE_INCLUDE_DIRECTORIES>")
+    set(defs "$<TARGET_PROPERTY:${target},INTERFACE_COMPILE_DEFINITIONS>")
+    file(GENERATE
+      OUTPUT "${CMAKE_BINARY_DIR}/.zyn-usage/${target}-$<CONFIG>.txt"
+      CONTENT "include $<JOIN:${dirs},\ninclude >
+define $<JOIN:${defs},\ndefine >
+${links}
+"
+      TARGET ${target})
+  endforeach()
+endfunction()
+
+cmake_language(DEFER CALL _zyn_export_usage)
+)";
+  return script;
+}
+
+static json read_json(const fs::path &path) {
+  std::ifstream in(path);
+  if (!in)
+    return json();
+  return json::parse(in, nullptr, false);
+}
+
+static std::string project_path(const fs::path &path) {
+  fs::path absolute = fs::absolute(path).lexically_normal();
+  fs::path relative = absolute.lexically_relative(fs::current_path());
+  if (!relative.empty() && *relative.begin() != "..")
+    return relative.string();
+  return absolute.string();
+}
+
+static bool is_auxiliary(const fs::path &relative) {
+  static const std::set<std::string> names = {
+      "test",     "tests",   "testing",    "example", "examples",
+      "doc",      "docs",    "benchmark",  "bench",   "benchmarks",
+      "samples",  "sample",  "fuzz",       "fuzzing", "tools"};
+  for (const auto &part : relative) {
+    std::string lowered = part.string();
+    std::transform(lowered.begin(), lowered.end(), lowered.begin(), ::tolower);
+    if (names.count(lowered))
+      return true;
+  }
+  return false;
+}
+
+static bool inside(const fs::path &path, const fs::path &root) {
+  fs::path relative = path.lexically_relative(root);
+  return !relative.empty() && *relative.begin() != "..";
+}
+
+static bool read_configuration(const fs::path &reply,
+                               const std::string &build_type, json &config) {
+  if (!fs::is_directory(reply))
+    return false;
+
+  fs::path index_path;
+  for (const auto &entry : fs::directory_iterator(reply)) {
+    const std::string file = entry.path().filename().string();
+    if (file.rfind("index-", 0) == 0 && entry.path() > index_path)
+      index_path = entry.path();
+  }
+
+  json index = read_json(index_path);
+  if (index.is_discarded() || !index.contains("reply"))
+    return false;
+  const json &entry = index["reply"]["codemodel-v2"];
+  if (!entry.is_object() || !entry.contains("jsonFile"))
+    return false;
+
+  json model = read_json(reply / entry["jsonFile"].get<std::string>());
+  if (model.is_discarded() || model["configurations"].empty())
+    return false;
+
+  config = model["configurations"][0];
+  for (const auto &candidate : model["configurations"]) {
+    if (candidate.value("name", "") == build_type)
+      config = candidate;
+  }
+  return true;
+}
+
+bool interface_only(const fs::path &build, const std::string &build_type) {
+  const fs::path reply = build / ".cmake/api/v1/reply";
+  json config;
+  if (!read_configuration(reply, build_type, config))
+    return false;
+
+  for (const auto &target : config["targets"]) {
+    json detail = read_json(reply / target["jsonFile"].get<std::string>());
+    if (detail.is_discarded())
+      return false;
+    const std::string type = detail.value("type", "");
+    if (type == "INTERFACE_LIBRARY" || type == "UTILITY" ||
+        detail.value("isGeneratorProvided", false) ||
+        is_auxiliary(detail["paths"].value("source", "")))
+      continue;
+    return false;
+  }
+  return true;
+}
+
+bool codemodel_usage(const fs::path &source, const fs::path &build,
+                     const std::string &build_type, DepUsage &usage) {
+  const fs::path reply = build / ".cmake/api/v1/reply";
+  json config;
+  if (!read_configuration(reply, build_type, config))
+    return false;
+
+  const fs::path source_root =
+      fs::absolute(source).lexically_normal();
+  const fs::path build_root = fs::absolute(build).lexically_normal();
+
+  std::map<std::string, json> targets;
+  for (const auto &target : config["targets"]) {
+    json detail = read_json(reply / target["jsonFile"].get<std::string>());
+    if (detail.is_discarded())
+      continue;
+    const std::string type = detail.value("type", "");
+    if (type != "STATIC_LIBRARY" && type != "SHARED_LIBRARY" &&
+        type != "OBJECT_LIBRARY" && type != "INTERFACE_LIBRARY")
+      continue;
+    if (detail.value("isGeneratorProvided", false) ||
+        is_auxiliary(detail["paths"].value("source", "")))
+      continue;
+    targets[target["id"].get<std::string>()] = std::move(detail);
+  }
+
+  std::vector<const json *> ordered;
+  std::set<std::string> visited;
+  std::function<void(const std::string &)> visit = [&](const std::string &id) {
+    auto it = targets.find(id);
+    if (it == targets.end() || !visited.insert(id).second)
+      return;
+    if (it->second.contains("dependencies")) {
+      for (const auto &dependency : it->second["dependencies"])
+        visit(dependency["id"].get<std::string>());
+    }
+    ordered.push_back(&it->second);
+  };
+  for (const auto &[id, _] : targets)
+    visit(id);
+  std::reverse(ordered.begin(), ordered.end());
+
+  const std::string config_name = config.value("name", "");
+  std::set<std::string> seen_includes, seen_defines, seen_links;
+  auto add_link = [&](std::string library) {
+    if (library.empty())
+      return;
+    if (library[0] != '-') {
+      if (fs::path(library).is_absolute())
+        library = project_path(library);
+      else if (library.find('/') == std::string::npos &&
+               library.find("::") == std::string::npos)
+        library = "-l" + library;
+      else
+        return;
+    }
+    if (seen_links.insert(library).second)
+      usage.link_libraries.push_back(library);
+  };
+
+  for (const json *target : ordered) {
+    DepUsage declared;
+    const std::string name = target->value("name", "");
+    if (read_usage(build_root / ".zyn-usage" /
+                       (name + "-" + config_name + ".txt"),
+                   declared)) {
+      for (const auto &dir : declared.include_dirs) {
+        if (!dir.empty() && seen_includes.insert(project_path(dir)).second)
+          usage.include_dirs.push_back(project_path(dir));
+      }
+      for (std::string define : declared.defines) {
+        if (define.rfind("-D", 0) == 0)
+          define.erase(0, 2);
+        if (!define.empty() && seen_defines.insert(define).second)
+          usage.defines.push_back(define);
+      }
+      for (const auto &library : declared.link_libraries)
+        add_link(library);
+      continue;
+    }
+
+    // No export from usage_script (CMake older than 3.19, or a build tree
+    // configured without it): approximate the usage requirements with the
+    // target's own compile settings, which also carry its PRIVATE ones.
+    if (target->contains("compileGroups")) {
+      for (const auto &group : (*target)["compileGroups"]) {
+        for (const auto &include : group.value("includes", json::array())) {
+          fs::path path =
+              fs::path(include["path"].get<std::string>()).lexically_normal();
+          bool owned = inside(path, source_root) || inside(path, build_root) ||
+                       path == source_root;
+          if (!owned || is_auxiliary(path.lexically_relative(source_root)))
+            continue;
+          std::string dir = project_path(path);
+          if (seen_includes.insert(dir).second)
+            usage.include_dirs.push_back(dir);
+        }
+        for (const auto &define : group.value("defines", json::array())) {
+          std::string value = define["define"].get<std::string>();
+          const std::string name = value.substr(0, value.find('='));
+          if (name.size() > 8 &&
+              name.compare(name.size() - 8, 8, "_EXPORTS") == 0)
+            continue;
+          if (seen_defines.insert(value).second)
+            usage.defines.push_back(value);
+        }
+      }
+    }
+
+    const std::string type = target->value("type", "");
+    if (type == "STATIC_LIBRARY" || type == "SHARED_LIBRARY") {
+      for (const auto &artifact : target->value("artifacts", json::array())) {
+        fs::path path = artifact["path"].get<std::string>();
+        if (path.is_relative())
+          path = build_root / path;
+        const std::string ext = path.extension().string();
+        if (ext != ".a" && ext != ".so" && ext != ".dylib" && ext != ".lib")
+          continue;
+        add_link(path.string());
+      }
+    }
+    if (target->contains("link")) {
+      for (const auto &fragment :
+           (*target)["link"].value("commandFragments", json::array())) {
+        if (fragment.value("role", "") != "libraries")
+          continue;
+        std::string library = fragment.value("fragment", "");
+        if (library.size() > 1 && library.front() == '"' &&
+            library.back() == '"')
+          library = library.substr(1, library.size() - 2);
+        if (library.rfind("-l", 0) == 0 || fs::path(library).is_absolute())
+          add_link(library);
+      }
+    }
+  }
+
+  return true;
+}
+
+DepUsage header_only_usage(const fs::path &source) {
+  DepUsage usage;
+  for (const char *name : {"include", "Include", "single_include"}) {
+    if (fs::is_directory(source / name)) {
+      usage.include_dirs.push_back(project_path(source / name));
+      return usage;
+    }
+  }
+  usage.include_dirs.push_back(project_path(source));
+  return usage;
+}
+
+void write_usage(const fs::path &path, const DepUsage &usage) {
+  fs::create_directories(path.parent_path());
+  fs::path tmp = path;
+  tmp += ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::trunc);
+    for (const auto &dir : usage.include_dirs)
+      out << "include " << dir << '\n';
+    for (const auto &define : usage.defines)
+      out << "define " << define << '\n';
+    for (const auto &library : usage.link_libraries)
+      out << "link " << library << '\n';
+    for (const auto &dependency : usage.dependencies)
+      out << "requires " << dependency << '\n';
+  }
+  fs::rename(tmp, path);
+}
+
+bool read_usage(const fs::path &path, DepUsage &usage) {
+  std::ifstream in(path);
+  if (!in)
+    return false;
+
+  std::string line;
+  while (std::getline(in, line)) {
+    const size_t space = line.find(' ');
+    if (space == std::string::npos)
+      continue;
+    const std::string kind = line.substr(0, space);
+    std::string value = line.substr(space + 1);
+    if (kind == "include")
+      usage.include_dirs.push_back(std::move(value));
+    else if (kind == "define")
+      usage.defines.push_back(std::move(value));
+    else if (kind == "link")
+      usage.link_libraries.push_back(std::move(value));
+    else if (kind == "requires")
+      usage.dependencies.push_back(std::move(value));
+  }
+  return true;
+}
+
+std::vector<std::string>
+link_order(const std::vector<std::string> &names,
+           const std::map<std::string, DepUsage> &all) {
+  std::vector<std::string> ordered;
+  std::set<std::string> visited;
+  std::function<void(const std::string &)> visit =
+      [&](const std::string &name) {
+        auto it = all.find(name);
+        if (it == all.end() || !visited.insert(name).second)
+          return;
+        for (const auto &dependency : it->second.dependencies)
+          visit(dependency);
+        ordered.push_back(name);
+      };
+  for (const auto &name : names)
+    visit(name);
+  std::reverse(ordered.begin(), ordered.end());
+  return ordered;
+}
+
+void export_usage(const std::string &name, const fs::path &source,
+                  const fs::path &build, const BuildVariant &variant,
+                  bool header_only,
+                  const std::vector<std::string> &dependencies) {
+  DepUsage usage;
+  if (header_only) {
+    usage = header_only_usage(source);
+  } else if (!codemodel_usage(source, build, variant.build_type, usage)) {
+    request_codemodel(build);
+    std::string cmd = "cmake \"" + build.string() +
+                      "\" \"-DCMAKE_PROJECT_INCLUDE=" +
+                      usage_script(build).string() + "\" >/dev/null";
+    if (std::system(cmd.c_str()) != 0 ||
+        !codemodel_usage(source, build, variant.build_type, usage)) {
+      usage = DepUsage();
+      find_include_dirs(source, usage.include_dirs);
+      find_include_dirs(build, usage.include_dirs);
+    }
+  }
+  if (usage.include_dirs.empty())
+    usage.include_dirs = header_only_usage(source).include_dirs;
+  usage.dependencies = dependencies;
+  write_usage(usage_path(variant.profile_key, name), usage);
+}
+
+} // namespace dependency_manager
@@ -0,0 +1,168 @@
+#include "../include/project_management/file_state.hpp"
+#include "../include/utils/binary_io.hpp"
+#include "../include/utils/hashing.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+namespace project_management {
+
+static const char file_state_magic[8] = {'Z', 'Y', 'N', 'F',
+                                         'S', '0', '0', '2'};
+
+// Files modified this recently may still change within the same mtime tick,
+// so their hashes are used for the current run but never persisted.
+static const int64_t racy_window_ns = 2'000'000'000;
+
+FileStateCache::FileStateCache(fs::path db_path)
+    : db_path_(std::move(db_path)) {
+  std::ifstream in(db_path_, std::ios::binary);
+  if (!in)
+    return;
+
+  char magic[sizeof(file_state_magic)];
+  if (!in.read(magic, sizeof(magic)) ||
+      !std::equal(magic, magic + sizeof(magic), file_state_magic))
+    return;
+
+  uint32_t count;
+  if (!utils::read_u32(in, count))
+    return;
+
+  for (uint32_t i = 0; i < count; ++i) {
+    std::string path;
+    FileState state;
+    uint64_t mtime;
+    if (!utils::read_str(in, path) || !utils::read_u64(in, state.size) ||
+        !utils::read_u64(in, mtime) || !utils::read_u64(in, state.inode) ||
+        !utils::read_str(in, state.hash)) {
+      entries_.clear();
+      return;
+    }
+    state.mtime_ns = static_cast<int64_t>(mtime);
+    state.stable = true;
+    entries_[path] = std::move(state);
+  }
+}
+
+static int64_t mtime_ns_of(const struct stat &st) {
+  return static_cast<int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 +
+         st.st_mtim.tv_nsec;
+}
+
+bool FileStateCache::lookup(const std::string &path, const struct stat &st,
+                            std::string &hash) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(path);
+  if (it == entries_.end() ||
+      it->second.size != static_cast<uint64_t>(st.st_size) ||
+      it->second.mtime_ns != mtime_ns_of(st) ||
+      it->second.inode != static_cast<uint64_t>(st.st_ino))
+    return false;
+
+  it->second.touched = true;
+  hash = it->second.hash;
+  return true;
+}
+
+void FileStateCache::store(const std::string &path, const struct stat &st,
+                           const std::string &hash) {
+  FileState state;
+  state.size = static_cast<uint64_t>(st.st_size);
+  state.mtime_ns = mtime_ns_of(st);
+  state.inode = static_cast<uint64_t>(st.st_ino);
+  state.hash = hash;
+  state.touched = true;
+
+  using std::chrono::nanoseconds;
+  const int64_t now_ns =
+      std::chrono::duration_cast<nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+  state.stable = now_ns - state.mtime_ns > racy_window_ns;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  dirty_ = dirty_ || state.stable;
+  entries_[path] = std::move(state);
+}
+
+std::string FileStateCache::hash(const std::string &path) {
+  struct stat st;
+  if (::stat(path.c_str(), &st) != 0)
+    return {};
+
+  std::string hash;
+  if (lookup(path, st, hash))
+    return hash;
+
+  hash = utils::fast_hash_file(path);
+  store(path, st, hash);
+  return hash;
+}
+
+void FileStateCache::prefetch(const std::vector<std::string> &paths) {
+  std::vector<std::string> missing;
+  std::vector<struct stat> stats;
+
+  for (const auto &path : paths) {
+    struct stat st;
+    std::string hash;
+    if (::stat(path.c_str(), &st) != 0 || lookup(path, st, hash))
+      continue;
+    missing.push_back(path);
+    stats.push_back(st);
+  }
+
+  std::vector<std::string> hashes = utils::fast_hash_files(missing);
+  for (size_t i = 0; i < missing.size(); ++i) {
+    if (!hashes[i].empty())
+      store(missing[i], stats[i], hashes[i]);
+  }
+}
+
+void FileStateCache::save() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!dirty_)
+    return;
+
+  fs::create_directories(db_path_.parent_path());
+  fs::path tmp = db_path_;
+  tmp += ".tmp";
+
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(file_state_magic, sizeof(file_state_magic));
+
+    std::vector<const std::pair<const std::string, FileState> *> kept;
+    for (const auto &entry : entries_) {
+      if (!entry.second.stable)
+        continue;
+      if (!entry.second.touched && !fs::exists(entry.first))
+        continue;
+      kept.push_back(&entry);
+    }
+
+    utils::write_u32(out, static_cast<uint32_t>(kept.size()));
+    for (const auto *entry : kept) {
+      utils::write_str(out, entry->first);
+      utils::write_u64(out, entry->second.size);
+      utils::write_u64(out, static_cast<uint64_t>(entry->second.mtime_ns));
+      utils::write_u64(out, entry->second.inode);
+      utils::write_str(out, entry->second.hash);
+    }
+  }
+
+  fs::rename(tmp, db_path_);
+  dirty_ = false;
+}
+
+FileStateCache &file_state() {
+  static FileStateCache cache(".zyn/cache/filestate.db");
+  return cache;
+}
+
+void save_file_state() { file_state().save(); }
+
+} // namespace project_management
@@ -1,24 +1,36 @@
 #include "../include/dependency_manager/git_dependency.hpp"
+#include "../include/dependency_manager/dep_manifest.hpp"
+#include "../include/dependency_manager/dep_usage.hpp"
+#include "../include/dependency_manager/git_mirror.hpp"
+#include "../include/dependency_manager/install_pipeline.hpp"
+#include "../include/project_management/compile_cmd_generator.hpp"
+#include "../include/project_management/lto.hpp"
 #include "../include/project_management/parser.hpp"
+#include "../include/utils/hashing.hpp"
+#include "../include/utils/jobserver.hpp"
+#include "../include/utils/thread_pool.hpp"
+#include "../include/utils/trace.hpp"
 #include <algorithm>
+#include <cctype>
 #include <cstdio>
+#include <deque>
 #include <filesystem>
 #include <fstream>
 #include <future>
 #include <iostream>
 #include <memory>
-#include <mutex>
 #include <openssl/sha.h>
 #include <regex>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
 namespace fs = std::filesystem;
-static std::mutex cout_mutex;
 
 namespace dependency_manager {
 std::string exec(const std::string &cmd) {
+  utils::TraceScope trace("process", cmd);
   std::vector<char> buffer(256);
   std::string result;
   std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd.c_str(), "r"),
@@ -31,21 +43,6 @@ std::string exec(const std::string &cmd) {
   return result;
 }
 
-std::string get_commit_hash(const fs::path &repo, const std::string &tag = {}) {
-  if (!tag.empty()) {
-    exec("git -C \"" + repo.string() + "\" fetch --tags");
-    std::string hash =
-        exec("git -C \"" + repo.string() + "\" rev-list -n 1 refs/tags/" + tag);
-    if (hash.empty()) {
-      throw std::runtime_error("Tag '" + tag +
-                               "' not found in repo: " + repo.string());
-    }
-    return hash;
-  }
-  return exec("git -C \"" + repo.string() +
-              "\" ls-remote origin HEAD | cut -f1");
-}
-
 std::string hex_string(const unsigned char *data, size_t len) {
   static const char hex_digits[] = "0123456789abcdef";
   std::string result;
@@ -57,30 +54,69 @@ std::string hex_string(const unsigned char *data, size_t len) {
   return result;
 }
 
-std::string hash_directory(const fs::path &dir) {
+std::vector<fs::path> lock_files(const fs::path &dir,
+                                 std::vector<fs::path> *dirs) {
+  utils::TraceScope trace("scan", "scan " + dir.string());
   std::vector<fs::path> files;
 
-  for (auto &p : fs::recursive_directory_iterator(dir)) {
+  for (auto it = fs::recursive_directory_iterator(dir);
+       it != fs::recursive_directory_iterator(); ++it) {
+    const auto &p = *it;
     if (fs::is_regular_file(p)) {
       std::string ext = p.path().extension().string();
       if (ext == ".cpp" || ext == ".h" ||
           p.path().filename() == "CMakeLists.txt") {
         files.push_back(p.path());
       }
+    } else if (dirs && p.is_directory()) {
+      const fs::path relative = p.path().lexically_relative(dir);
+      if (std::find(relative.begin(), relative.end(), ".git") ==
+          relative.end())
+        dirs->push_back(p.path());
     }
   }
 
   std::sort(files.begin(), files.end());
+  return files;
+}
+
+std::string hash_directory(const fs::path &dir) {
+  utils::TraceScope trace("hash", "hash " + dir.string());
+  std::vector<fs::path> files = lock_files(dir);
 
   SHA256_CTX ctx;
   SHA256_Init(&ctx);
 
-  for (const auto &file : files) {
-    std::ifstream in(file, std::ios::binary);
-    std::vector<char> buffer((std::istreambuf_iterator<char>(in)),
-                             std::istreambuf_iterator<char>());
-    SHA256_Update(&ctx, reinterpret_cast<const unsigned char *>(buffer.data()),
-                  buffer.size());
+  // The lock digest is one sequential SHA-256 stream, so the pool only maps
+  // and pre-faults the next files while the current one is being hashed.
+  utils::ThreadPool pool;
+  const size_t window = pool.size() * 4;
+  std::deque<std::future<std::unique_ptr<utils::MappedFile>>> pending;
+  size_t next = 0;
+
+  auto schedule = [&]() {
+    while (next < files.size() && pending.size() < window) {
+      fs::path file = files[next++];
+      pending.push_back(
+          pool.submit([file]() -> std::unique_ptr<utils::MappedFile> {
+            try {
+              auto mapped = std::make_unique<utils::MappedFile>(file);
+              mapped->will_need();
+              return mapped;
+            } catch (const std::exception &) {
+              return nullptr;
+            }
+          }));
+    }
+  };
+
+  schedule();
+  while (!pending.empty()) {
+    std::unique_ptr<utils::MappedFile> mapped = pending.front().get();
+    pending.pop_front();
+    schedule();
+    if (mapped && mapped->size() > 0)
+      SHA256_Update(&ctx, mapped->data(), mapped->size());
   }
 
   unsigned char hash[32];
@@ -114,30 +150,193 @@ bool check_lock(const std::string &name, const std::string &rev,
   return file_rev == rev && file_hash == hash;
 }
 
-void clone_if_missing(const fs::path &path, const std::string &url) {
-  if (!fs::exists(path / ".git")) {
-    std::string cmd = "git clone \"" + url + "\" \"" + path.string() + "\"";
-    if (std::system(cmd.c_str()) != 0)
-      throw std::runtime_error("Git clone failed: " + url);
+std::string shell_quote(const std::string &value) {
+  std::string quoted = "\"";
+  for (char c : value) {
+    if (c == '"' || c == '\\' || c == '$' || c == '`')
+      quoted.push_back('\\');
+    quoted.push_back(c);
+  }
+  quoted.push_back('"');
+  return quoted;
+}
+
+std::string c_compiler_for(const std::string &cxx_compiler) {
+  static const std::pair<const char *, const char *> pairs[] = {
+      {"clang++", "clang"}, {"g++", "gcc"}, {"c++", "cc"}};
+  for (const auto &[cxx, c] : pairs) {
+    const std::string suffix = cxx;
+    if (cxx_compiler.size() >= suffix.size() &&
+        cxx_compiler.compare(cxx_compiler.size() - suffix.size(),
+                             suffix.size(), suffix) == 0)
+      return cxx_compiler.substr(0, cxx_compiler.size() - suffix.size()) + c;
   }
+  return {};
+}
+
+bool ninja_supports_jobserver() {
+  std::string version = exec("ninja --version 2>/dev/null");
+  int major = 0, minor = 0;
+  if (std::sscanf(version.c_str(), "%d.%d", &major, &minor) != 2)
+    return false;
+  return major > 1 || (major == 1 && minor >= 13);
+}
+
+utils::Jobserver &shared_jobserver(unsigned jobs) {
+  static utils::Jobserver server(jobs > 0 ? jobs : utils::default_jobs());
+  return server;
+}
+
+BuildVariant make_build_variant(const project_management::Config &cfg,
+                                const std::string &profile, unsigned jobs) {
+  BuildVariant variant;
+  variant.jobs = jobs;
+
+  std::string flags;
+  std::vector<std::string> profile_flags;
+  if (auto it = cfg.profiles.find(profile); it != cfg.profiles.end()) {
+    profile_flags = it->second;
+    for (const auto &flag :
+         project_management::lto_flags(cfg, it->second).compile)
+      flags += (flags.empty() ? "" : " ") + flag;
+  }
+  variant.profile_key =
+      project_management::profile_key(cfg, profile, profile_flags);
+
+  std::string optimization;
+  bool debug_info = false;
+  bool lto = false;
+  std::istringstream tokens(flags);
+  for (std::string token; tokens >> token;) {
+    if (token.rfind("-O", 0) == 0)
+      optimization = token;
+    else if (token == "-g" || token.rfind("-ggdb", 0) == 0 ||
+             (token.size() == 3 && token.rfind("-g", 0) == 0 &&
+              std::isdigit(static_cast<unsigned char>(token[2]))))
+      debug_info = token != "-g0";
+    else if (token.rfind("-flto", 0) == 0)
+      lto = true;
+  }
+
+  std::string lowered = profile;
+  std::transform(lowered.begin(), lowered.end(), lowered.begin(), ::tolower);
+
+  if (lowered.find("debug") != std::string::npos || optimization == "-O0" ||
+      (optimization.empty() && debug_info))
+    variant.build_type = "Debug";
+  else if (optimization == "-Os" || optimization == "-Oz")
+    variant.build_type = "MinSizeRel";
+  else if (debug_info)
+    variant.build_type = "RelWithDebInfo";
+  else
+    variant.build_type = "Release";
+
+  if (ninja_supports_jobserver())
+    variant.generator = "Ninja";
+
+  variant.cmake_args.push_back("-DCMAKE_BUILD_TYPE=" + variant.build_type);
+  if (!variant.generator.empty())
+    variant.cmake_args.push_back("-G " + shell_quote(variant.generator));
+
+  if (cfg.language == "c") {
+    variant.cmake_args.push_back("-DCMAKE_C_COMPILER=" +
+                                 shell_quote(cfg.compiler));
+  } else {
+    variant.cmake_args.push_back("-DCMAKE_CXX_COMPILER=" +
+                                 shell_quote(cfg.compiler));
+    if (std::string c_compiler = c_compiler_for(cfg.compiler);
+        !c_compiler.empty())
+      variant.cmake_args.push_back("-DCMAKE_C_COMPILER=" +
+                                   shell_quote(c_compiler));
+  }
+
+  if (!flags.empty()) {
+    variant.cmake_args.push_back("-DCMAKE_C_FLAGS=" + shell_quote(flags));
+    variant.cmake_args.push_back("-DCMAKE_CXX_FLAGS=" + shell_quote(flags));
+  }
+  if (lto)
+    variant.cmake_args.push_back("-DCMAKE_INTERPROCEDURAL_OPTIMIZATION=ON");
+
+  std::string identity;
+  for (const auto &arg : variant.cmake_args)
+    identity += arg + '\0';
+
+  std::string type = variant.build_type;
+  std::transform(type.begin(), type.end(), type.begin(), ::tolower);
+  variant.key = type + "-" + utils::fast_hash(identity).substr(0, 8);
+
+  return variant;
+}
+
+fs::path variant_build_dir(const std::string &name,
+                           const BuildVariant &variant) {
+  return fs::path(".zyn/build") / name / variant.key;
 }
 
-void checkout_commit(const fs::path &repo, const std::string &commit) {
-  std::string cmd = "git -C \"" + repo.string() + "\" fetch origin " + commit +
-                    " && git -C \"" + repo.string() + "\" reset --hard " +
-                    commit;
-  if (std::system(cmd.c_str()) != 0)
-    throw std::runtime_error("Git checkout failed");
+bool is_header_only(const fs::path &dir,
+                    const project_management::Dependency &dep) {
+  if (dep.header_only)
+    return *dep.header_only;
+  return !fs::exists(dir / "CMakeLists.txt");
 }
 
-void build_cmake(const fs::path &source, const fs::path &build) {
+bool is_variant_built(const fs::path &build, const std::string &commit) {
+  std::ifstream in(build / ".zyn-stamp");
+  std::string built_commit;
+  std::getline(in, built_commit);
+  return !commit.empty() && built_commit == commit;
+}
+
+void configure_cmake(const fs::path &source, const fs::path &build,
+                     const BuildVariant &variant,
+                     const std::vector<fs::path> &prefixes) {
   fs::create_directories(build);
+  request_codemodel(build);
   std::string cmake = "cmake -S \"" + source.string() + "\" -B \"" +
                       build.string() +
-                      "\" -DCMAKE_POSITION_INDEPENDENT_CODE=ON";
-  std::string make = "cmake --build \"" + build.string() + "\"";
-  if (std::system(cmake.c_str()) != 0 || std::system(make.c_str()) != 0)
-    throw std::runtime_error("Build failed");
+                      "\" --no-warn-unused-cli"
+                      " -DCMAKE_POSITION_INDEPENDENT_CODE=ON " +
+                      shell_quote("-DCMAKE_PROJECT_INCLUDE=" +
+                                  usage_script(build).string());
+  for (const auto &arg : variant.cmake_args)
+    cmake += " " + arg;
+  if (!prefixes.empty()) {
+    std::string paths;
+    for (const auto &prefix : prefixes)
+      paths += (paths.empty() ? "" : ";") + fs::absolute(prefix).string();
+    cmake += " " + shell_quote("-DCMAKE_PREFIX_PATH=" + paths);
+  }
+
+  utils::Jobserver::Token token(shared_jobserver(variant.jobs));
+  utils::TraceScope trace("process", cmake);
+  if (std::system(cmake.c_str()) != 0)
+    throw std::runtime_error("Configure failed");
+}
+
+void compile_cmake(const fs::path &build, const BuildVariant &variant,
+                   const std::string &commit) {
+  // No --parallel: make and ninja pick up the shared jobserver from MAKEFLAGS,
+  // and this build's own slot is the token held below.
+  std::string make = "cmake --build \"" + build.string() + "\" --config " +
+                     variant.build_type;
+
+  // Projects whose codemodel has nothing but INTERFACE targets (header-only
+  // libraries) have nothing to compile.
+  if (!interface_only(build, variant.build_type)) {
+    utils::Jobserver::Token token(shared_jobserver(variant.jobs));
+    utils::TraceScope trace("process", make);
+    if (std::system(make.c_str()) != 0)
+      throw std::runtime_error("Build failed");
+  }
+
+  std::ofstream(build / ".zyn-stamp") << commit << '\n';
+}
+
+void build_cmake(const fs::path &source, const fs::path &build,
+                 const BuildVariant &variant, const std::string &commit,
+                 const std::vector<fs::path> &prefixes) {
+  configure_cmake(source, build, variant, prefixes);
+  compile_cmake(build, variant, commit);
 }
 
 bool check_lock_strict(const std::string &name, const std::string &expected_rev,
@@ -195,51 +394,10 @@ bool check_lock_strict(const std::string &name, const std::string &expected_rev,
   return true;
 }
 
-void ensure_git_dep(const std::string &name, const std::string &url,
-                    const std::string &tag) {
-  try {
-    fs::path base = ".zyn";
-    fs::path dep_dir = base / "deps" / name;
-    fs::path build_dir = base / "build" / name;
-    fs::path lock_path = base / "lock" / (name + ".lock");
-
-    clone_if_missing(dep_dir, url);
-    std::string commit = get_commit_hash(dep_dir, tag);
-
-    if (fs::exists(lock_path)) {
-      checkout_commit(dep_dir, commit);
-      std::string current_hash = hash_directory(dep_dir);
-
-      if (check_lock_strict(name, commit, current_hash)) {
-        std::lock_guard<std::mutex> lock(cout_mutex);
-        std::cout << "[Zyn] " << name << " is up-to-date and locked.\n";
-        return;
-      } else {
-        std::lock_guard<std::mutex> lock(cout_mutex);
-        std::cerr << "[Zyn] Lock mismatch for " << name << ".\n";
-        std::cerr << "[Zyn] Aborting install. Use `zyn update` to refresh.\n";
-        std::exit(1);
-      }
-    }
-
-    {
-      std::lock_guard<std::mutex> lock(cout_mutex);
-      std::cout << "[Zyn] Installing " << name << "...\n";
-    }
-
-    checkout_commit(dep_dir, commit);
-    std::string new_hash = hash_directory(dep_dir);
-    write_lock(lock_path, commit, new_hash);
-    build_cmake(dep_dir, build_dir);
-
-    {
-      std::lock_guard<std::mutex> lock(cout_mutex);
-      std::cout << "[Zyn] " << name << " ready.\n";
-    }
-  } catch (const std::exception &ex) {
-    std::lock_guard<std::mutex> lock(cout_mutex);
-    std::cerr << "[Zyn] Error installing " << name << ": " << ex.what() << "\n";
-  }
+void ensure_git_dep(const std::string &name,
+                    const project_management::Dependency &dep,
+                    const BuildVariant &variant) {
+  install_dependencies({{name, dep}}, variant, pipeline_limits(variant.jobs));
 }
 
 void find_include_dirs(const fs::path &basePath,
@@ -257,7 +415,8 @@ void find_include_dirs(const fs::path &basePath,
   }
 }
 
-void install_from_url(const std::string &input) {
+void install_from_url(const std::string &input, const std::string &profile,
+                      unsigned jobs) {
   std::string url = input, tag;
   if (auto pos = input.find('@'); pos != std::string::npos) {
     url = input.substr(0, pos);
@@ -284,14 +443,10 @@ void install_from_url(const std::string &input) {
     return;
   } else {
     project_management::Dependency dep{.git = url, .tag = tag};
+    dep.shallow = cfg.shallow_deps;
 
     if (tag.empty()) {
-      std::string tmp = ".zyn/tmp_" + name;
-      std::string cmd = "git clone --bare \"" + url + "\" \"" + tmp + "\"";
-      if (std::system(cmd.c_str()) != 0)
-        throw std::runtime_error("Clone failed");
-      tag = exec("git --git-dir=\"" + tmp + "\" describe --tags --abbrev=0");
-      fs::remove_all(tmp);
+      tag = mirror_latest_tag(url);
       dep.tag = tag;
       std::cout << "[Zyn] Latest tag resolved: " << tag << "\n";
     } else {
@@ -300,20 +455,7 @@ void install_from_url(const std::string &input) {
         test_tag = "v" + tag;
       }
 
-      std::string tmp = ".zyn/tmp_" + name;
-      std::string clone_cmd =
-          "git clone --bare \"" + url + "\" \"" + tmp + "\"";
-      if (std::system(clone_cmd.c_str()) != 0)
-        throw std::runtime_error("Clone failed");
-
-      std::string check_tag_cmd = "git --git-dir=\"" + tmp +
-                                  "\" rev-parse --verify --quiet refs/tags/" +
-                                  test_tag;
-      std::string verify_result = exec(check_tag_cmd);
-
-      fs::remove_all(tmp);
-
-      if (!verify_result.empty()) {
+      if (mirror_has_tag(url, test_tag)) {
         tag = test_tag;
       }
       dep.tag = tag;
@@ -323,7 +465,8 @@ void install_from_url(const std::string &input) {
     project_management::save("zyn.toml", cfg);
   }
 
-  ensure_git_dep(name, url, tag);
+  ensure_git_dep(name, cfg.dependencies[name],
+                 make_build_variant(cfg, profile, jobs));
   std::vector<std::string> include_dirs;
 
   find_include_dirs(".zyn/deps", include_dirs);
@@ -334,63 +477,77 @@ void install_from_url(const std::string &input) {
   }
 }
 
-void install_all_from_config() {
-  project_management::Config cfg = project_management::parse("zyn.toml");
-
-  std::vector<std::future<void>> futures;
-
+std::unordered_map<std::string, project_management::Dependency>
+git_dependencies(const project_management::Config &cfg) {
+  std::unordered_map<std::string, project_management::Dependency> roots;
   for (const auto &[name, dep] : cfg.dependencies) {
     if (!dep.git.empty()) {
-      futures.push_back(std::async(std::launch::async, ensure_git_dep, name,
-                                   dep.git, dep.tag));
+      roots.emplace(name, dep);
     } else if (!dep.path.empty()) {
-      std::lock_guard<std::mutex> lock(cout_mutex);
       std::cout << "[Zyn] Skipping local/path dependency \"" << name << "\"\n";
     } else {
-      std::lock_guard<std::mutex> lock(cout_mutex);
       std::cout << "[Zyn] Dependency \"" << name
                 << "\" has no git or path. Skipping.\n";
     }
   }
+  return roots;
+}
 
-  for (auto &fut : futures) {
-    fut.get();
-  }
+void install_all_from_config(const std::string &profile, unsigned jobs) {
+  project_management::Config cfg = project_management::parse("zyn.toml");
+  if (jobs == 0)
+    jobs = cfg.jobs > 0 ? cfg.jobs : utils::default_jobs();
+  BuildVariant variant = make_build_variant(cfg, profile, jobs);
+
+  install_dependencies(git_dependencies(cfg), variant, pipeline_limits(jobs));
 }
 
-void update_git_dependency(const std::string &name, const std::string &url,
-                           const std::string &tag) {
+void update_git_dependency(const std::string &name,
+                           const project_management::Dependency &dep,
+                           const BuildVariant &variant) {
   fs::path dep_dir = ".zyn/deps/" + name;
-  fs::path build_dir = ".zyn/build/" + name;
+  fs::path build_dir = variant_build_dir(name, variant);
   fs::path lock_path = ".zyn/lock/" + name + ".lock";
 
-  clone_if_missing(dep_dir, url);
-  std::string latest_commit = get_commit_hash(dep_dir, tag);
-  checkout_commit(dep_dir, latest_commit);
+  std::string latest_commit = fetch_dependency(dep_dir, dep);
+  checkout_dependency(dep_dir, dep, latest_commit);
   std::string new_hash = hash_directory(dep_dir);
 
+  bool header_only = is_header_only(dep_dir, dep);
   bool needs_update = !check_lock(name, latest_commit, new_hash);
-  if (needs_update) {
+  if (needs_update ||
+      (!header_only && !is_variant_built(build_dir, latest_commit))) {
     std::cout << "[Zyn] Updating " << name << "...\n";
     write_lock(lock_path, latest_commit, new_hash);
-    build_cmake(dep_dir, build_dir);
+    if (!header_only)
+      build_cmake(dep_dir, build_dir, variant, latest_commit);
     std::cout << "[Zyn] " << name << " updated.\n";
   } else {
     std::cout << "[Zyn] " << name << " is already up-to-date.\n";
   }
+  std::vector<std::string> required;
+  if (fs::exists(dep_dir / "zyn.toml")) {
+    for (const auto &[child, child_dep] :
+         project_management::parse((dep_dir / "zyn.toml").string())
+             .dependencies) {
+      if (!child_dep.git.empty())
+        required.push_back(child);
+    }
+  }
+  export_usage(name, dep_dir, build_dir, variant, header_only, required);
+  write_dep_manifest(name, checkout_source(dep), dep.tag, latest_commit,
+                     new_hash, dep_dir);
 }
 
-void update_all_dependencies() {
+void update_all_dependencies(const std::string &profile, unsigned jobs) {
   auto config = project_management::parse("zyn.toml");
+  BuildVariant variant = make_build_variant(config, profile, jobs);
 
   for (const auto &[name, dep] : config.dependencies) {
-    std::string url = dep.git;
-    std::string tag = dep.tag;
-
-    if (url.empty())
+    if (dep.git.empty())
       continue;
 
-    update_git_dependency(name, url, tag);
+    update_git_dependency(name, dep, variant);
   }
 }
 } // namespace dependency_manager
\ No newline at end of file
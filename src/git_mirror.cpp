@@ -0,0 +1,250 @@
+#include "../include/dependency_manager/git_mirror.hpp"
+#include "../include/dependency_manager/git_dependency.hpp"
+#include "../include/utils/hashing.hpp"
+#include "../include/utils/trace.hpp"
+#include "../include/utils/utils.hpp"
+#include <cctype>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace dependency_manager {
+
+struct MirrorState {
+  std::mutex mutex;
+  bool fresh = false;
+};
+
+class MirrorLock {
+public:
+  explicit MirrorLock(const fs::path &path)
+      : fd_(::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)) {
+    if (fd_ >= 0)
+      ::flock(fd_, LOCK_EX);
+  }
+  ~MirrorLock() {
+    if (fd_ >= 0)
+      ::close(fd_);
+  }
+
+  MirrorLock(const MirrorLock &) = delete;
+  MirrorLock &operator=(const MirrorLock &) = delete;
+
+private:
+  int fd_;
+};
+
+static MirrorState &mirror_state(const std::string &url) {
+  static std::mutex registry_mutex;
+  static std::map<std::string, std::unique_ptr<MirrorState>> registry;
+
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  auto &state = registry[url];
+  if (!state)
+    state = std::make_unique<MirrorState>();
+  return *state;
+}
+
+static int run_git(const std::string &cmd) {
+  utils::TraceScope trace("git", cmd);
+  return std::system(cmd.c_str());
+}
+
+static std::string git_dir_arg(const fs::path &mirror) {
+  return "git --git-dir=\"" + mirror.string() + "\"";
+}
+
+fs::path mirror_dir(const std::string &url) {
+  std::string base = url;
+  while (!base.empty() && base.back() == '/')
+    base.pop_back();
+  base = base.substr(base.find_last_of("/:") + 1);
+  if (base.size() > 4 && base.compare(base.size() - 4, 4, ".git") == 0)
+    base.resize(base.size() - 4);
+
+  std::string name;
+  for (char c : base)
+    name.push_back(std::isalnum(static_cast<unsigned char>(c)) || c == '-' ||
+                           c == '_' || c == '.'
+                       ? c
+                       : '_');
+  if (name.empty() || name[0] == '.')
+    name = "repo" + name;
+
+  return utils::user_cache_dir() / "git" /
+         (name + "-" + utils::fast_hash(url).substr(0, 8) + ".git");
+}
+
+fs::path ensure_mirror(const std::string &url) {
+  fs::path mirror = mirror_dir(url);
+  MirrorState &state = mirror_state(url);
+  std::lock_guard<std::mutex> guard(state.mutex);
+  if (state.fresh)
+    return mirror;
+
+  fs::create_directories(mirror.parent_path());
+  fs::path lock_path = mirror;
+  lock_path += ".lock";
+  MirrorLock lock(lock_path);
+
+  if (!fs::exists(mirror / "HEAD")) {
+    fs::path tmp = mirror;
+    tmp += ".tmp";
+    fs::remove_all(tmp);
+    std::string cmd = "git clone --quiet --mirror \"" + url + "\" \"" +
+                      tmp.string() + "\" && " + git_dir_arg(tmp) +
+                      " config gc.pruneExpire never";
+    if (run_git(cmd) != 0) {
+      fs::remove_all(tmp);
+      throw std::runtime_error("Git clone failed: " + url);
+    }
+    fs::rename(tmp, mirror);
+  } else {
+    std::string cmd = git_dir_arg(mirror) + " fetch --quiet --prune origin";
+    if (run_git(cmd) != 0)
+      std::cerr << "[Zyn] Could not update mirror of " << url
+                << ", using the cached copy.\n";
+  }
+
+  state.fresh = true;
+  return mirror;
+}
+
+std::string mirror_commit(const std::string &url, const std::string &tag) {
+  fs::path mirror = ensure_mirror(url);
+  if (tag.empty())
+    return exec(git_dir_arg(mirror) + " rev-parse HEAD");
+
+  std::string hash =
+      exec(git_dir_arg(mirror) + " rev-list -n 1 refs/tags/" + tag);
+  if (hash.empty())
+    throw std::runtime_error("Tag '" + tag + "' not found in repo: " + url);
+  return hash;
+}
+
+std::string mirror_latest_tag(const std::string &url) {
+  return exec(git_dir_arg(ensure_mirror(url)) + " describe --tags --abbrev=0");
+}
+
+bool mirror_has_tag(const std::string &url, const std::string &tag) {
+  return !exec(git_dir_arg(ensure_mirror(url)) +
+               " rev-parse --verify --quiet refs/tags/" + tag)
+              .empty();
+}
+
+void clone_from_mirror(const fs::path &path, const std::string &url) {
+  if (fs::exists(path / ".git"))
+    return;
+
+  fs::path mirror = ensure_mirror(url);
+  std::string cmd = "git clone --quiet --shared --no-checkout \"" +
+                    mirror.string() + "\" \"" + path.string() +
+                    "\" && git -C \"" + path.string() +
+                    "\" remote set-url origin \"" + url + "\"";
+  if (run_git(cmd) != 0)
+    throw std::runtime_error("Git clone failed: " + url);
+}
+
+void checkout_from_mirror(const fs::path &repo, const std::string &url,
+                          const std::string &commit) {
+  const std::string git = "git -C \"" + repo.string() + "\"";
+  std::string cmd = git + " cat-file -e " + commit + "^{commit} 2>/dev/null";
+  if (run_git(cmd) != 0) {
+    cmd = git + " fetch --quiet \"" + ensure_mirror(url).string() + "\" " +
+          commit;
+    if (run_git(cmd) != 0)
+      throw std::runtime_error("Git checkout failed");
+  }
+
+  cmd = git + " reset --quiet --hard " + commit;
+  if (run_git(cmd) != 0)
+    throw std::runtime_error("Git checkout failed");
+}
+
+std::string shallow_fetch(const fs::path &repo, const std::string &url,
+                          const std::string &tag) {
+  const std::string git = "git -C \"" + repo.string() + "\"";
+  if (!fs::exists(repo / ".git")) {
+    std::string cmd = "git clone --quiet --depth 1 --filter=blob:none "
+                      "--no-checkout";
+    if (!tag.empty())
+      cmd += " --branch " + tag;
+    cmd += " \"" + url + "\" \"" + repo.string() + "\"";
+    if (run_git(cmd) != 0)
+      throw std::runtime_error("Git clone failed: " + url);
+    if (tag.empty())
+      return exec(git + " rev-parse HEAD");
+  } else {
+    std::string cmd = git + " fetch --quiet --force --depth 1 origin " +
+                      (tag.empty() ? std::string("HEAD") : "tag " + tag);
+    if (run_git(cmd) != 0)
+      throw std::runtime_error("Git fetch failed: " + url);
+    if (tag.empty())
+      return exec(git + " rev-parse FETCH_HEAD");
+  }
+
+  std::string hash = exec(git + " rev-list -n 1 refs/tags/" + tag);
+  if (hash.empty())
+    throw std::runtime_error("Tag '" + tag + "' not found in repo: " + url);
+  return hash;
+}
+
+void apply_sparse(const fs::path &repo, const std::vector<std::string> &paths) {
+  std::string cmd = "git -C \"" + repo.string() + "\" sparse-checkout ";
+  if (paths.empty()) {
+    std::string check = "git -C \"" + repo.string() +
+                        "\" config --get core.sparseCheckout >/dev/null";
+    if (run_git(check) != 0)
+      return;
+    cmd += "disable";
+  } else {
+    cmd += "set";
+    for (const auto &path : paths)
+      cmd += " \"" + path + "\"";
+  }
+
+  if (run_git(cmd) != 0)
+    throw std::runtime_error("Git sparse-checkout failed");
+}
+
+std::string checkout_source(const project_management::Dependency &dep) {
+  std::string source = dep.git;
+  if (dep.shallow)
+    source += " shallow";
+  for (const auto &path : dep.sparse)
+    source += " sparse:" + path;
+  return source;
+}
+
+std::string fetch_dependency(const fs::path &repo,
+                             const project_management::Dependency &dep) {
+  if (dep.shallow)
+    return shallow_fetch(repo, dep.git, dep.tag);
+
+  std::string commit = mirror_commit(dep.git, dep.tag);
+  clone_from_mirror(repo, dep.git);
+  return commit;
+}
+
+void checkout_dependency(const fs::path &repo,
+                         const project_management::Dependency &dep,
+                         const std::string &commit) {
+  apply_sparse(repo, dep.sparse);
+  if (!dep.shallow) {
+    checkout_from_mirror(repo, dep.git, commit);
+    return;
+  }
+
+  std::string cmd =
+      "git -C \"" + repo.string() + "\" reset --quiet --hard " + commit;
+  if (run_git(cmd) != 0)
+    throw std::runtime_error("Git checkout failed");
+}
+
+} // namespace dependency_manager
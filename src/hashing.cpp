@@ -0,0 +1,199 @@
+#include "../include/utils/hashing.hpp"
+#include "../include/utils/thread_pool.hpp"
+#include "../include/utils/trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <future>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace utils {
+
+static const uint64_t prime64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t prime64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t prime64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t prime64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const unsigned char *p) {
+  uint64_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static inline uint32_t read32(const unsigned char *p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+  acc += input * prime64_2;
+  acc = rotl64(acc, 31);
+  return acc * prime64_1;
+}
+
+static inline uint64_t xxh64_merge(uint64_t acc, uint64_t value) {
+  acc ^= xxh64_round(0, value);
+  return acc * prime64_1 + prime64_4;
+}
+
+uint64_t xxh64(const void *data, size_t len, uint64_t seed) {
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+  const unsigned char *end = p + len;
+  uint64_t h64;
+
+  if (len >= 32) {
+    const unsigned char *limit = end - 32;
+    uint64_t v1 = seed + prime64_1 + prime64_2;
+    uint64_t v2 = seed + prime64_2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - prime64_1;
+
+    do {
+      v1 = xxh64_round(v1, read64(p));
+      v2 = xxh64_round(v2, read64(p + 8));
+      v3 = xxh64_round(v3, read64(p + 16));
+      v4 = xxh64_round(v4, read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+
+    h64 = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+    h64 = xxh64_merge(h64, v1);
+    h64 = xxh64_merge(h64, v2);
+    h64 = xxh64_merge(h64, v3);
+    h64 = xxh64_merge(h64, v4);
+  } else {
+    h64 = seed + prime64_5;
+  }
+
+  h64 += static_cast<uint64_t>(len);
+
+  while (p + 8 <= end) {
+    h64 ^= xxh64_round(0, read64(p));
+    h64 = rotl64(h64, 27) * prime64_1 + prime64_4;
+    p += 8;
+  }
+
+  if (p + 4 <= end) {
+    h64 ^= static_cast<uint64_t>(read32(p)) * prime64_1;
+    h64 = rotl64(h64, 23) * prime64_2 + prime64_3;
+    p += 4;
+  }
+
+  while (p < end) {
+    h64 ^= static_cast<uint64_t>(*p) * prime64_5;
+    h64 = rotl64(h64, 11) * prime64_1;
+    ++p;
+  }
+
+  h64 ^= h64 >> 33;
+  h64 *= prime64_2;
+  h64 ^= h64 >> 29;
+  h64 *= prime64_3;
+  h64 ^= h64 >> 32;
+  return h64;
+}
+
+std::string to_hex(uint64_t value) {
+  static const char hex_digits[] = "0123456789abcdef";
+  std::string result(16, '0');
+  for (int i = 15; i >= 0; --i) {
+    result[i] = hex_digits[value & 0xF];
+    value >>= 4;
+  }
+  return result;
+}
+
+MappedFile::MappedFile(const fs::path &path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    throw std::runtime_error("Could not open file: " + path.string());
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    throw std::runtime_error("Could not stat file: " + path.string());
+  }
+
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_ > 0) {
+    void *mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      ::close(fd);
+      throw std::runtime_error("Could not map file: " + path.string());
+    }
+    ::madvise(mapped, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const unsigned char *>(mapped);
+  }
+  ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_)
+    ::munmap(const_cast<unsigned char *>(data_), size_);
+}
+
+void MappedFile::will_need() const {
+  if (data_)
+    ::madvise(const_cast<unsigned char *>(data_), size_, MADV_WILLNEED);
+}
+
+std::string fast_hash(const std::string &data) {
+  return to_hex(xxh64(data.data(), data.size()));
+}
+
+std::string fast_hash_file(const fs::path &path) {
+  MappedFile file(path);
+  return to_hex(xxh64(file.data(), file.size()));
+}
+
+std::vector<std::string> fast_hash_files(const std::vector<std::string> &paths,
+                                         unsigned jobs) {
+  std::vector<std::string> hashes(paths.size());
+  if (paths.empty())
+    return hashes;
+
+  TraceScope trace("hash", "hash " + std::to_string(paths.size()) + " files");
+
+  auto hash_one = [&](size_t i) {
+    try {
+      hashes[i] = fast_hash_file(paths[i]);
+    } catch (const std::exception &) {
+      hashes[i].clear();
+    }
+  };
+
+  if (jobs == 0)
+    jobs = default_jobs();
+  if (paths.size() == 1 || jobs == 1) {
+    for (size_t i = 0; i < paths.size(); ++i)
+      hash_one(i);
+    return hashes;
+  }
+
+  std::atomic<size_t> next{0};
+  ThreadPool pool(
+      std::min<unsigned>(jobs, static_cast<unsigned>(paths.size())), "hash");
+  std::vector<std::future<void>> workers;
+  for (unsigned w = 0; w < pool.size(); ++w) {
+    workers.push_back(pool.submit([&]() {
+      for (size_t i = next++; i < paths.size(); i = next++)
+        hash_one(i);
+    }));
+  }
+  for (auto &worker : workers)
+    worker.get();
+
+  return hashes;
+}
+
+} // namespace utils
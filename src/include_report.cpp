@@ -0,0 +1,244 @@
+#include "../include/project_management/include_report.hpp"
+#include "../include/dependency_manager/git_dependency.hpp"
+#include "../include/project_management/parser.hpp"
+#include "../include/utils/thread_pool.hpp"
+#include "../include/utils/utils.hpp"
+#include <algorithm>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iterator>
+#include <iostream>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+namespace project_management {
+
+using json = nlohmann::json;
+
+struct IncludeNode {
+  std::string path;
+  size_t depth;
+  uint64_t size;
+  uint64_t inclusive;
+  std::vector<size_t> children;
+};
+
+static bool is_dependency_header(const std::string &path) {
+  return path.rfind(".zyn/deps/", 0) == 0 || path.rfind(".zyn/build/", 0) == 0;
+}
+
+static bool is_project_header(const std::string &path) {
+  return !path.empty() && path.front() != '/' && path.rfind(".zyn/", 0) != 0;
+}
+
+static uint64_t file_size(const std::string &path) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, uint64_t> sizes;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = sizes.find(path);
+  if (it != sizes.end())
+    return it->second;
+
+  std::error_code ec;
+  uint64_t size = fs::file_size(path, ec);
+  return sizes[path] = ec ? 0 : size;
+}
+
+bool read_include_tree(const std::string &output, const fs::path &source,
+                       IncludeReport &report) {
+  // -H prints one line per opened header, "." repeated once per nesting
+  // level. Index 0 is the translation unit itself.
+  std::vector<IncludeNode> nodes;
+  nodes.push_back({source.lexically_normal().string(), 0,
+                   file_size(source.string()), 0, {}});
+  std::vector<size_t> stack = {0};
+
+  std::istringstream in(output);
+  std::string line;
+  while (std::getline(in, line)) {
+    size_t depth = 0;
+    while (depth < line.size() && line[depth] == '.')
+      ++depth;
+    if (depth == 0 || depth >= line.size() || line[depth] != ' ')
+      continue;
+
+    std::string path =
+        fs::path(line.substr(depth + 1)).lexically_normal().string();
+    while (stack.size() > depth)
+      stack.pop_back();
+    if (stack.empty())
+      continue;
+
+    nodes.push_back({path, depth, file_size(path), 0, {}});
+    nodes[stack.back()].children.push_back(nodes.size() - 1);
+    stack.push_back(nodes.size() - 1);
+  }
+
+  for (size_t i = nodes.size(); i-- > 0;) {
+    nodes[i].inclusive = nodes[i].size;
+    for (size_t child : nodes[i].children)
+      nodes[i].inclusive += nodes[child].inclusive;
+  }
+
+  ++report.units;
+  report.total_bytes += nodes[0].inclusive;
+
+  std::set<std::string> seen;
+  std::set<std::string> pulled;
+  for (size_t i = 1; i < nodes.size(); ++i) {
+    const IncludeNode &node = nodes[i];
+    HeaderCost &cost = report.headers[node.path];
+    cost.size = node.size;
+    cost.inclusive_bytes += node.inclusive;
+    if (seen.insert(node.path).second)
+      ++cost.fan_in;
+
+    if (!is_project_header(node.path))
+      continue;
+    for (size_t child : node.children) {
+      const IncludeNode &dep = nodes[child];
+      if (!is_dependency_header(dep.path))
+        continue;
+      DependencyPull &pull = report.dependency_pulls[node.path];
+      if (pulled.insert(node.path).second)
+        ++pull.count;
+      pull.bytes += dep.inclusive;
+      pull.headers[dep.path] += dep.inclusive;
+    }
+  }
+
+  return nodes.size() > 1;
+}
+
+static std::string format_bytes(double bytes) {
+  static const char *units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+  size_t unit = 0;
+  while (bytes >= 1024 && unit + 1 < std::size(units)) {
+    bytes /= 1024;
+    ++unit;
+  }
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(unit == 0 ? 0 : 1) << bytes << " "
+      << units[unit];
+  return out.str();
+}
+
+void analyze_includes(const RunOptions &options, size_t top) {
+  Config cfg = parse("zyn.toml");
+  const unsigned jobs = resolve_jobs(cfg, options);
+  dependency_manager::install_all_from_config(options.profile, jobs);
+
+  BuildPlan plan = generate_compile_cmd(cfg, options.profile,
+                                        profile_flags(cfg, options.profile));
+  std::cout << "[Zyn] Preprocessing " << plan.units.size()
+            << " files with -H...\n";
+
+  IncludeReport report;
+  std::mutex mutex;
+  {
+    utils::ThreadPool pool(
+        std::min<unsigned>(jobs, static_cast<unsigned>(plan.units.size())),
+        "preprocess");
+    std::vector<std::future<void>> pending;
+    for (const auto &unit : plan.units) {
+      pending.push_back(pool.submit([&, unit]() {
+        utils::ProcessResult result =
+            utils::run_captured(unit.identity + " -E -H -o /dev/null");
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (result.exit_code != 0) {
+          std::cerr << "Command failed with code " << result.exit_code
+                    << ": " << unit.source.string() << "\n"
+                    << result.output;
+          return;
+        }
+        read_include_tree(result.output, unit.source, report);
+      }));
+    }
+    for (auto &job : pending)
+      job.get();
+  }
+
+  std::vector<std::pair<std::string, HeaderCost>> headers(
+      report.headers.begin(), report.headers.end());
+  std::sort(headers.begin(), headers.end(), [](const auto &a, const auto &b) {
+    return a.second.inclusive_bytes > b.second.inclusive_bytes;
+  });
+
+  std::vector<std::pair<std::string, DependencyPull>> pulls(
+      report.dependency_pulls.begin(), report.dependency_pulls.end());
+  std::sort(pulls.begin(), pulls.end(), [](const auto &a, const auto &b) {
+    return a.second.bytes > b.second.bytes;
+  });
+
+  std::cout << "\n"
+            << report.units << " translation units, "
+            << format_bytes(static_cast<double>(report.total_bytes))
+            << " lexed in total";
+  if (report.units > 0)
+    std::cout << " ("
+              << format_bytes(static_cast<double>(report.total_bytes) /
+                              static_cast<double>(report.units))
+              << " per unit)";
+  std::cout << ".\n";
+
+  std::cout << "\nHeaders by bytes x fan-in (fan-in, size, with includes, "
+               "project total):\n";
+  for (size_t i = 0; i < headers.size() && i < top; ++i) {
+    const auto &[path, cost] = headers[i];
+    std::cout << std::setw(6) << cost.fan_in << "  " << std::setw(10)
+              << format_bytes(static_cast<double>(cost.size)) << "  "
+              << std::setw(10)
+              << format_bytes(static_cast<double>(cost.inclusive_bytes) /
+                              static_cast<double>(cost.fan_in))
+              << "  " << std::setw(10)
+              << format_bytes(static_cast<double>(cost.inclusive_bytes))
+              << "  " << path << "\n";
+  }
+
+  if (!pulls.empty()) {
+    std::cout << "\nProject headers pulling in .zyn dependency headers "
+                 "(candidates for forward declarations or PIMPL):\n";
+    for (size_t i = 0; i < pulls.size() && i < top; ++i) {
+      const auto &[path, pull] = pulls[i];
+      auto heaviest = std::max_element(
+          pull.headers.begin(), pull.headers.end(),
+          [](const auto &a, const auto &b) { return a.second < b.second; });
+      std::cout << std::setw(10)
+                << format_bytes(static_cast<double>(pull.bytes)) << "  "
+                << std::setw(4) << pull.count << " TUs  " << path << " -> "
+                << heaviest->first << "\n";
+    }
+  }
+
+  json out = {{"units", report.units},
+              {"total_bytes", report.total_bytes},
+              {"headers", json::array()},
+              {"dependency_pulls", json::array()}};
+  for (const auto &[path, cost] : headers) {
+    out["headers"].push_back({{"path", path},
+                              {"fan_in", cost.fan_in},
+                              {"size", cost.size},
+                              {"inclusive_bytes", cost.inclusive_bytes}});
+  }
+  for (const auto &[path, pull] : pulls) {
+    out["dependency_pulls"].push_back({{"header", path},
+                                       {"units", pull.count},
+                                       {"bytes", pull.bytes},
+                                       {"dependency_headers", pull.headers}});
+  }
+
+  const fs::path dir = fs::path(".zyn/build/analyze") / plan.profile_key;
+  fs::create_directories(dir);
+  std::ofstream(dir / "includes.json") << out.dump(2) << "\n";
+  std::cout << "\n[Zyn] Report written to "
+            << (dir / "includes.json").string() << "\n";
+}
+
+} // namespace project_management
@@ -0,0 +1,383 @@
+#include "../include/dependency_manager/install_pipeline.hpp"
+#include "../include/dependency_manager/dep_manifest.hpp"
+#include "../include/dependency_manager/dep_usage.hpp"
+#include "../include/dependency_manager/git_mirror.hpp"
+#include "../include/utils/trace.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+namespace dependency_manager {
+
+static std::mutex cout_mutex;
+
+struct DepNode {
+  std::string name;
+  project_management::Dependency dep;
+  std::string source;
+  fs::path dep_dir;
+  fs::path build_dir;
+  fs::path lock_path;
+  std::string commit;
+  std::vector<std::string> children;
+  bool locked = false;
+  bool offline = false;
+  bool header_only = false;
+  bool needs_build = false;
+  bool verified = false;
+  bool configuring = false;
+  bool configured = false;
+  bool building = false;
+  bool done = false;
+  bool failed = false;
+};
+
+PipelineLimits pipeline_limits(unsigned jobs) {
+  if (jobs == 0)
+    jobs = utils::default_jobs();
+  return {std::min(jobs, 8u), std::max(jobs / 4, 1u), jobs};
+}
+
+InstallPipeline::InstallPipeline(const BuildVariant &variant,
+                                 const PipelineLimits &limits)
+    : variant_(variant), fetch_pool_(limits.fetch, "fetch"),
+      verify_pool_(limits.verify, "verify"),
+      build_pool_(limits.build, "cmake") {}
+
+InstallPipeline::~InstallPipeline() { wait(); }
+
+DepNode *InstallPipeline::insert(const std::string &name,
+                                 const project_management::Dependency &dep,
+                                 const std::string &parent) {
+  auto &slot = nodes_[name];
+  if (slot) {
+    if (slot->dep.git != dep.git || slot->dep.tag != dep.tag) {
+      std::lock_guard<std::mutex> lock(cout_mutex);
+      std::cerr << "[Zyn] " << parent << " requires " << name << " from "
+                << dep.git << "@" << dep.tag << ", keeping " << slot->dep.git
+                << "@" << slot->dep.tag << ".\n";
+    }
+    return nullptr;
+  }
+
+  slot = std::make_unique<DepNode>();
+  slot->name = name;
+  slot->dep = dep;
+  slot->source = checkout_source(dep);
+  slot->dep_dir = fs::path(".zyn/deps") / name;
+  slot->build_dir = variant_build_dir(name, variant_);
+  slot->lock_path = fs::path(".zyn/lock") / (name + ".lock");
+  return slot.get();
+}
+
+template <typename F>
+void InstallPipeline::submit(utils::ThreadPool &pool, F stage) {
+  ++pending_;
+  pool.submit([this, stage]() {
+    stage();
+
+    std::vector<std::pair<std::string, bool>> finished;
+    Listener listener;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      finished.swap(finished_);
+      listener = listener_;
+      ++notifying_;
+    }
+    if (listener) {
+      for (const auto &[name, ok] : finished)
+        listener(name, ok);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    --notifying_;
+    --pending_;
+    changed_.notify_all();
+  });
+}
+
+void InstallPipeline::add(const std::string &name,
+                          const project_management::Dependency &dep) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (DepNode *node = insert(name, dep, "zyn.toml"))
+    submit(fetch_pool_, [this, node]() { fetch(*node); });
+}
+
+void InstallPipeline::set_listener(Listener listener) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this]() { return notifying_ == 0; });
+  listener_ = std::move(listener);
+}
+
+bool InstallPipeline::finished(const std::string &name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = nodes_.find(name);
+  return it == nodes_.end() || it->second->done || it->second->failed;
+}
+
+void InstallPipeline::fail(DepNode &node, const std::string &reason) {
+  node.failed = true;
+  finished_.emplace_back(node.name, false);
+  std::lock_guard<std::mutex> lock(cout_mutex);
+  std::cerr << "[Zyn] Error installing " << node.name << ": " << reason
+            << "\n";
+}
+
+void InstallPipeline::fetch(DepNode &node) {
+  utils::TraceScope trace("install", "fetch " + node.name);
+  std::vector<std::pair<std::string, project_management::Dependency>> required;
+  // Results stay local until mutex_ is held: schedule() reads these fields
+  // of every node from other workers.
+  bool locked = false;
+  bool offline = false;
+  bool header_only = false;
+  std::string commit;
+
+  try {
+    locked = fs::exists(node.lock_path);
+    if (locked) {
+      utils::TraceScope check("verify", "manifest " + node.name);
+      offline = dep_manifest_matches(node.name, node.source, node.dep.tag,
+                                     node.dep_dir);
+    }
+
+    if (offline) {
+      commit = read_head_commit(node.dep_dir);
+    } else {
+      if (!locked) {
+        std::lock_guard<std::mutex> lock(cout_mutex);
+        std::cout << "[Zyn] Installing " << node.name << "...\n";
+      }
+      commit = fetch_dependency(node.dep_dir, node.dep);
+      checkout_dependency(node.dep_dir, node.dep, commit);
+    }
+
+    header_only = is_header_only(node.dep_dir, node.dep);
+
+    fs::path manifest = node.dep_dir / "zyn.toml";
+    if (fs::exists(manifest)) {
+      project_management::Config cfg =
+          project_management::parse(manifest.string());
+      for (const auto &[name, dep] : cfg.dependencies) {
+        if (!dep.git.empty())
+          required.emplace_back(name, dep);
+      }
+    }
+  } catch (const std::exception &ex) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fail(node, ex.what());
+    schedule();
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  node.locked = locked;
+  node.offline = offline;
+  node.header_only = header_only;
+  node.commit = std::move(commit);
+  for (const auto &[name, dep] : required) {
+    node.children.push_back(name);
+    if (DepNode *child = insert(name, dep, node.name))
+      if (!aborted_)
+        submit(fetch_pool_, [this, child]() { fetch(*child); });
+  }
+
+  if (node.offline) {
+    node.verified = true;
+    schedule();
+  } else if (!aborted_) {
+    submit(verify_pool_, [this, &node]() { verify(node); });
+  }
+}
+
+void InstallPipeline::verify(DepNode &node) {
+  utils::TraceScope trace("install", "verify " + node.name);
+  try {
+    std::string hash = hash_directory(node.dep_dir);
+    if (node.locked) {
+      if (!check_lock_strict(node.name, node.commit, hash)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        node.failed = true;
+        aborted_ = true;
+        finished_.emplace_back(node.name, false);
+        std::lock_guard<std::mutex> out(cout_mutex);
+        std::cerr << "[Zyn] Lock mismatch for " << node.name << ".\n";
+        return;
+      }
+    } else {
+      write_lock(node.lock_path, node.commit, hash);
+    }
+    write_dep_manifest(node.name, node.source, node.dep.tag, node.commit, hash,
+                       node.dep_dir);
+  } catch (const std::exception &ex) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fail(node, ex.what());
+    schedule();
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  node.verified = true;
+  schedule();
+}
+
+void InstallPipeline::configure(DepNode &node,
+                                const std::vector<fs::path> &prefixes) {
+  utils::TraceScope trace("install", "configure " + node.name);
+  try {
+    if (node.header_only) {
+      if (!node.offline) {
+        std::lock_guard<std::mutex> lock(cout_mutex);
+        std::cout << "[Zyn] " << node.name
+                  << " is header-only, skipping build.\n";
+      }
+    } else if (!is_variant_built(node.build_dir, node.commit)) {
+      {
+        std::lock_guard<std::mutex> lock(cout_mutex);
+        std::cout << "[Zyn] Building " << node.name << " (" << variant_.key
+                  << ")...\n";
+      }
+      configure_cmake(node.dep_dir, node.build_dir, variant_, prefixes);
+      node.needs_build = true;
+    }
+
+    if (node.needs_build || !node.offline ||
+        !fs::exists(usage_path(variant_.profile_key, node.name)))
+      export_usage(node.name, node.dep_dir, node.build_dir, variant_,
+                   node.header_only, node.children);
+  } catch (const std::exception &ex) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fail(node, ex.what());
+    schedule();
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  node.configured = true;
+  schedule();
+}
+
+void InstallPipeline::build(DepNode &node) {
+  utils::TraceScope trace("install", "build " + node.name);
+  try {
+    if (node.needs_build)
+      compile_cmake(node.build_dir, variant_, node.commit);
+  } catch (const std::exception &ex) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fail(node, ex.what());
+    schedule();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(cout_mutex);
+    if (node.locked)
+      std::cout << "[Zyn] " << node.name << " is up-to-date and locked.\n";
+    else
+      std::cout << "[Zyn] " << node.name << " ready.\n";
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  node.done = true;
+  finished_.emplace_back(node.name, true);
+  schedule();
+}
+
+void InstallPipeline::schedule() {
+  if (aborted_)
+    return;
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto &[name, node] : nodes_) {
+      if (node->failed || node->building)
+        continue;
+      if (!node->verified || (node->configuring && !node->configured))
+        continue;
+
+      bool configure_ready = true;
+      bool build_ready = true;
+      std::vector<fs::path> prefixes;
+      for (const auto &child_name : node->children) {
+        const DepNode &child = *nodes_.at(child_name);
+        if (child.failed) {
+          fail(*node, "dependency " + child_name + " failed");
+          changed = true;
+          configure_ready = build_ready = false;
+          break;
+        }
+        configure_ready = configure_ready && child.configured;
+        build_ready = build_ready && child.done;
+        if (!child.header_only)
+          prefixes.push_back(child.build_dir);
+      }
+
+      DepNode *target = node.get();
+      if (!node->configuring && configure_ready) {
+        node->configuring = true;
+        submit(build_pool_, [this, target, prefixes]() {
+          configure(*target, prefixes);
+        });
+      } else if (node->configured && build_ready) {
+        node->building = true;
+        submit(build_pool_, [this, target]() { build(*target); });
+      }
+    }
+  }
+}
+
+void InstallPipeline::settle(std::unique_lock<std::mutex> &lock) {
+  if (aborted_) {
+    changed_.wait(lock, [this]() { return pending_ == 0; });
+    std::lock_guard<std::mutex> out(cout_mutex);
+    std::cerr << "[Zyn] Aborting install. Use `zyn update` to refresh.\n";
+    std::exit(1);
+  }
+
+  if (pending_ > 0)
+    return;
+  for (auto &[name, node] : nodes_) {
+    if (!node->done && !node->failed)
+      fail(*node, "dependency cycle");
+  }
+}
+
+void InstallPipeline::wait_configured() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this]() {
+    if (pending_ == 0 || aborted_)
+      return true;
+    return std::all_of(nodes_.begin(), nodes_.end(), [](const auto &entry) {
+      return entry.second->configured || entry.second->failed;
+    });
+  });
+  settle(lock);
+}
+
+void InstallPipeline::wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this]() { return pending_ == 0; });
+}
+
+bool InstallPipeline::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this]() { return pending_ == 0; });
+  settle(lock);
+
+  return std::all_of(nodes_.begin(), nodes_.end(),
+                     [](const auto &entry) { return entry.second->done; });
+}
+
+bool install_dependencies(
+    const std::unordered_map<std::string, project_management::Dependency>
+        &roots,
+    const BuildVariant &variant, const PipelineLimits &limits) {
+  InstallPipeline pipeline(variant, limits);
+  for (const auto &[name, dep] : roots)
+    pipeline.add(name, dep);
+
+  return pipeline.run();
+}
+
+} // namespace dependency_manager
@@ -0,0 +1,166 @@
+#include "../include/project_management/isa.hpp"
+#include "../include/dependency_manager/install_pipeline.hpp"
+#include "../include/project_management/compile_cmd_generator.hpp"
+#include "../include/utils/thread_pool.hpp"
+#include "../include/utils/trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace project_management {
+
+// CPU features that define each x86-64 microarchitecture level, as named by
+// __builtin_cpu_supports.
+static const std::vector<std::pair<std::string, std::vector<std::string>>>
+    level_features = {
+        {"x86-64", {}},
+        {"x86-64-v2", {"popcnt", "sse4.2", "ssse3"}},
+        {"x86-64-v3", {"avx2", "bmi", "bmi2", "fma"}},
+        {"x86-64-v4", {"avx512f", "avx512bw", "avx512cd", "avx512dq",
+                       "avx512vl"}},
+};
+
+static size_t level_rank(const std::string &level) {
+  for (size_t i = 0; i < level_features.size(); ++i) {
+    if (level_features[i].first == level)
+      return i;
+  }
+  throw std::runtime_error("Unknown ISA level '" + level +
+                           "', expected x86-64, x86-64-v2, x86-64-v3 or "
+                           "x86-64-v4");
+}
+
+const std::vector<std::string> &isa_levels(const Config &cfg,
+                                           const std::string &profile) {
+  static const std::vector<std::string> none;
+  auto it = cfg.profile_isa.find(profile);
+  return it != cfg.profile_isa.end() ? it->second : none;
+}
+
+static std::string launcher_source(const std::vector<std::string> &levels) {
+  std::ostringstream out;
+  out << "#include <limits.h>\n"
+         "#include <stdio.h>\n"
+         "#include <string.h>\n"
+         "#include <unistd.h>\n\n"
+         "int main(int argc, char **argv) {\n"
+         "  char path[PATH_MAX];\n"
+         "  ssize_t n =\n"
+         "      readlink(\"/proc/self/exe\", path, sizeof(path) - 16);\n"
+         "  if (n < 0) {\n"
+         "    perror(\"/proc/self/exe\");\n"
+         "    return 127;\n"
+         "  }\n"
+         "  path[n] = '\\0';\n"
+         "  (void)argc;\n"
+         "  __builtin_cpu_init();\n";
+
+  for (const auto &level : levels) {
+    std::string condition;
+    for (const auto &feature : level_features[level_rank(level)].second) {
+      condition += condition.empty() ? "" : " &&\n      ";
+      condition += "__builtin_cpu_supports(\"" + feature + "\")";
+    }
+    out << "  if (" << (condition.empty() ? "1" : condition) << ") {\n"
+        << "    strcat(path, \"." << level << "\");\n"
+        << "    execv(path, argv);\n"
+        << "    perror(path);\n"
+        << "    return 127;\n"
+        << "  }\n";
+  }
+
+  out << "  fprintf(stderr, \"No build of this program supports this "
+         "CPU.\\n\");\n"
+         "  return 1;\n"
+         "}\n";
+  return out.str();
+}
+
+static bool build_launcher(const Config &cfg,
+                           const std::vector<std::string> &levels,
+                           const fs::path &dir) {
+  const fs::path source = dir / ("launcher." + cfg.language);
+  const fs::path launcher = dir / cfg.name;
+  const std::string code = launcher_source(levels);
+
+  std::ifstream in(source);
+  std::stringstream stored;
+  stored << in.rdbuf();
+  in.close();
+  if (stored.str() == code && fs::exists(launcher))
+    return true;
+
+  std::ofstream(source) << code;
+  utils::TraceScope trace("isa", "launcher");
+  return run_command(cfg.compiler + " -O2 " + source.string() + " -o " +
+                     launcher.string()) == 0;
+}
+
+bool isa_build(const Config &cfg, const RunOptions &options,
+               dependency_manager::InstallPipeline *pipeline) {
+  // Variants compile concurrently, so dependencies are installed up front
+  // rather than overlapped with each variant.
+  if (pipeline && !pipeline->run()) {
+    std::cerr << "Dependency install failed, aborting run.\n";
+    return false;
+  }
+
+  // Best level first, so the launcher picks the fastest supported variant.
+  std::vector<std::string> levels = isa_levels(cfg, options.profile);
+  std::sort(levels.begin(), levels.end(),
+            [](const std::string &a, const std::string &b) {
+              return level_rank(a) > level_rank(b);
+            });
+  levels.erase(std::unique(levels.begin(), levels.end()), levels.end());
+
+  std::atomic<bool> ok{true};
+  {
+    utils::ThreadPool pool(static_cast<unsigned>(levels.size()), "isa");
+    std::vector<std::future<void>> builds;
+    for (const auto &level : levels) {
+      builds.push_back(pool.submit([&cfg, &options, &ok, level]() {
+        Config variant = cfg;
+        variant.name = cfg.name + "." + level;
+        RunOptions variant_options = options;
+        variant_options.stage_flags.push_back("-march=" + level);
+        std::cout << "[Zyn] Building " << level << " variant...\n";
+        if (!build(variant, variant_options))
+          ok = false;
+      }));
+    }
+    for (auto &result : builds)
+      result.get();
+  }
+  if (!ok)
+    return false;
+
+  BuildPlan plan;
+  plan.published = fs::path(".zyn/build") / cfg.name;
+  const fs::path dir =
+      fs::path(".zyn/build/isa") /
+      profile_key(cfg, options.profile, profile_flags(cfg, options.profile));
+  fs::create_directories(dir);
+
+  for (const auto &level : levels) {
+    const std::string name = cfg.name + "." + level;
+    fs::copy_file(plan.published.parent_path() /
+                      fs::read_symlink(plan.published.parent_path() / name),
+                  dir / name, fs::copy_options::update_existing);
+  }
+
+  if (!build_launcher(cfg, levels, dir)) {
+    std::cerr << "[Zyn] Could not build the ISA launcher.\n";
+    return false;
+  }
+
+  plan.output = dir / cfg.name;
+  publish_output(plan);
+  std::cout << "[Zyn] " << plan.published.string() << " selects the best of "
+            << levels.size() << " ISA variants at startup.\n";
+  return true;
+}
+
+} // namespace project_management
@@ -0,0 +1,197 @@
+#include "../include/utils/jobserver.hpp"
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace utils {
+
+Jobserver::Jobserver(unsigned jobs) : jobs_(jobs == 0 ? 1 : jobs) {
+  // Private pipe that interrupts the thread polling the jobserver when the
+  // implicit job is returned; it never carries jobserver tokens.
+  if (::pipe(wake_fds_) != 0)
+    throw std::runtime_error("Failed to create jobserver wake pipe");
+  for (int fd : wake_fds_) {
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+  }
+
+  if (const char *flags = std::getenv("MAKEFLAGS")) {
+    had_makeflags_ = true;
+    saved_makeflags_ = flags;
+  }
+
+  if (join_existing())
+    return;
+
+  int fds[2];
+  if (::pipe(fds) != 0)
+    throw std::runtime_error("Failed to create jobserver pipe");
+  read_fd_ = fds[0];
+  write_fd_ = fds[1];
+  owner_ = true;
+
+  // Every client implicitly owns one job, so the pipe holds jobs - 1 tokens.
+  std::string tokens(jobs_ - 1, '+');
+  if (!tokens.empty() &&
+      ::write(write_fd_, tokens.data(), tokens.size()) !=
+          static_cast<ssize_t>(tokens.size()))
+    throw std::runtime_error("Failed to fill jobserver pipe");
+
+  const std::string fds_arg =
+      std::to_string(read_fd_) + "," + std::to_string(write_fd_);
+  const std::string makeflags = " -j" + std::to_string(jobs_) +
+                                " --jobserver-fds=" + fds_arg +
+                                " --jobserver-auth=" + fds_arg;
+  ::setenv("MAKEFLAGS", makeflags.c_str(), 1);
+}
+
+Jobserver::~Jobserver() {
+  ::close(wake_fds_[0]);
+  ::close(wake_fds_[1]);
+  if (fifo_)
+    ::close(read_fd_);
+  if (!owner_)
+    return;
+
+  if (had_makeflags_)
+    ::setenv("MAKEFLAGS", saved_makeflags_.c_str(), 1);
+  else
+    ::unsetenv("MAKEFLAGS");
+  ::close(read_fd_);
+  ::close(write_fd_);
+}
+
+bool Jobserver::join_existing() {
+  if (!had_makeflags_)
+    return false;
+
+  for (const char *option : {"--jobserver-auth=", "--jobserver-fds="}) {
+    auto pos = saved_makeflags_.find(option);
+    if (pos == std::string::npos)
+      continue;
+
+    int read_fd = -1, write_fd = -1;
+    std::string value =
+        saved_makeflags_.substr(pos + std::string(option).size());
+    if (value.rfind("fifo:", 0) == 0) {
+      // GNU make 4.4 passes a named pipe; one read-write descriptor serves
+      // both directions.
+      const std::string path = value.substr(5, value.find(' ') - 5);
+      read_fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+      if (read_fd == -1)
+        continue;
+      write_fd = read_fd;
+      fifo_ = true;
+    } else if (std::sscanf(value.c_str(), "%d,%d", &read_fd, &write_fd) != 2 ||
+               ::fcntl(read_fd, F_GETFD) == -1 ||
+               ::fcntl(write_fd, F_GETFD) == -1) {
+      continue;
+    }
+
+    read_fd_ = read_fd;
+    write_fd_ = write_fd;
+    auto j = saved_makeflags_.find("-j");
+    if (j != std::string::npos && j + 2 < saved_makeflags_.size() &&
+        std::isdigit(static_cast<unsigned char>(saved_makeflags_[j + 2])))
+      jobs_ = static_cast<unsigned>(std::atoi(&saved_makeflags_[j + 2]));
+    return true;
+  }
+
+  return false;
+}
+
+// Waits for a token on the jobserver pipe; returns false when woken because
+// the implicit job came back instead.
+bool Jobserver::read_token(char &token) {
+  pollfd fds[2] = {{read_fd_, POLLIN, 0}, {wake_fds_[0], POLLIN, 0}};
+  while (true) {
+    if (::poll(fds, 2, -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      throw std::runtime_error("Failed to wait for jobserver token");
+    }
+
+    if (fds[1].revents & POLLIN) {
+      char drain[16];
+      while (::read(wake_fds_[0], drain, sizeof(drain)) > 0) {
+      }
+      return false;
+    }
+
+    if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+      ssize_t n = ::read(read_fd_, &token, 1);
+      if (n == 1)
+        return true;
+      if (n < 0 && errno == EINTR)
+        continue;
+      throw std::runtime_error("Failed to acquire jobserver token");
+    }
+  }
+}
+
+void Jobserver::acquire() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    if (!implicit_taken_) {
+      implicit_taken_ = true;
+      return;
+    }
+
+    // One thread polls the pipe; the others wait here for the implicit job
+    // or for their turn to poll.
+    if (reading_) {
+      released_.wait(lock);
+      continue;
+    }
+
+    reading_ = true;
+    lock.unlock();
+    char token;
+    bool acquired = false;
+    try {
+      acquired = read_token(token);
+    } catch (...) {
+      lock.lock();
+      reading_ = false;
+      released_.notify_all();
+      throw;
+    }
+    lock.lock();
+    reading_ = false;
+    released_.notify_all();
+
+    if (acquired) {
+      held_.push_back(token);
+      return;
+    }
+  }
+}
+
+void Jobserver::release() {
+  char token;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (held_.empty()) {
+      implicit_taken_ = false;
+      if (reading_) {
+        const char wake = 0;
+        while (::write(wake_fds_[1], &wake, 1) < 0 && errno == EINTR) {
+        }
+      }
+      released_.notify_all();
+      return;
+    }
+    token = held_.back();
+    held_.pop_back();
+  }
+
+  while (::write(write_fd_, &token, 1) < 0 && errno == EINTR) {
+  }
+}
+
+} // namespace utils
@@ -0,0 +1,87 @@
+#include "../include/project_management/lto.hpp"
+#include "../include/project_management/compile_cache.hpp"
+#include "../include/utils/thread_pool.hpp"
+#include "../include/utils/utils.hpp"
+#include <cctype>
+#include <filesystem>
+#include <sstream>
+
+namespace project_management {
+
+static const char *lto_cache_dir = ".zyn/cache/lto";
+
+static int gcc_major_version(const std::string &compiler) {
+  utils::ProcessResult version =
+      utils::run_captured(compiler + " -dumpversion");
+  int major = 0;
+  for (char c : version.output) {
+    if (!std::isdigit(static_cast<unsigned char>(c)))
+      break;
+    major = major * 10 + (c - '0');
+  }
+  return major;
+}
+
+LtoFlags lto_flags(const Config &cfg, const std::vector<std::string> &flags) {
+  LtoFlags result;
+  if (cfg.lto != "thin") {
+    result.compile = flags;
+    return result;
+  }
+
+  bool lto = false;
+  bool custom_linker = false;
+  for (const auto &flag : flags) {
+    std::istringstream tokens(flag);
+    for (std::string token; tokens >> token;) {
+      if (token == "-flto" || token.rfind("-flto=", 0) == 0) {
+        lto = true;
+        continue;
+      }
+      custom_linker = custom_linker || token.rfind("-fuse-ld=", 0) == 0;
+      result.compile.push_back(token);
+    }
+  }
+
+  // Profiles without -flto keep their flags untouched.
+  if (!lto) {
+    result.compile = flags;
+    return result;
+  }
+
+  const std::string cache = lto_cache_dir;
+  result.cache_dir = cache;
+  const unsigned jobs = cfg.jobs > 0 ? cfg.jobs : utils::default_jobs();
+
+  if (is_clang(cfg.compiler)) {
+    result.compile.push_back("-flto=thin");
+#ifdef __APPLE__
+    result.link.push_back("-Wl,-cache_path_lto," + cache);
+#else
+    if (!custom_linker)
+      result.link.push_back("-fuse-ld=lld");
+    result.link.push_back("-Wl,--thinlto-cache-dir=" + cache);
+    result.link.push_back("-Wl,--thinlto-cache-policy=prune_after=168h");
+    result.link.push_back("-Wl,--thinlto-jobs=" + std::to_string(jobs));
+#endif
+  } else {
+    // GCC has no ThinLTO; partitioned WHOPR with parallel LTRANS jobs is the
+    // closest. The job count only matters where LTRANS runs, at link time.
+    result.compile.push_back("-flto");
+    result.link.push_back("-flto=" + std::to_string(jobs));
+    result.gcc = true;
+  }
+
+  return result;
+}
+
+void prepare_lto_link(const Config &cfg, LtoFlags &lto) {
+  if (lto.cache_dir.empty())
+    return;
+  std::filesystem::create_directories(lto.cache_dir);
+  // GCC 15 can reuse unchanged LTRANS partitions from a cache.
+  if (lto.gcc && gcc_major_version(cfg.compiler) >= 15)
+    lto.link.push_back("-flto-incremental=" + lto.cache_dir);
+}
+
+} // namespace project_management
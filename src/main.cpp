@@ -1,13 +1,16 @@
 #include "../include/dependency_manager/git_dependency.hpp"
 #include "../include/dependency_manager/local_dependency.hpp"
+#include "../include/project_management/bench.hpp"
+#include "../include/project_management/build_analyzer.hpp"
 #include "../include/project_management/clean_project.hpp"
-#include "../include/project_management/compile_cmd_generator.hpp"
 #include "../include/project_management/ide_generator.hpp"
+#include "../include/project_management/include_report.hpp"
 #include "../include/project_management/project_creator.hpp"
 #include "../include/project_management/runner.hpp"
+#include "../include/project_management/self_bench.hpp"
 #include <filesystem>
 #include <iostream>
-#include <sstream>
+#include <stdexcept>
 #include <string>
 
 namespace fs = std::filesystem;
@@ -31,10 +34,26 @@ int main(int argc, char *argv[]) {
       std::cout << "Project \"" << config.name << "\" created.\n";
 
     } else if (command == "install") {
-      if (argc == 3) {
-        dependency_manager::install_from_url(argv[2]);
+      std::string url, profile;
+      unsigned jobs = 0;
+      for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-j" || arg == "--jobs") && i + 1 < argc) {
+          jobs = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg.rfind("-j", 0) == 0 && arg.size() > 2) {
+          jobs = static_cast<unsigned>(std::stoul(arg.substr(2)));
+        } else if (arg.find('/') != std::string::npos ||
+                   arg.find(':') != std::string::npos) {
+          url = arg;
+        } else {
+          profile = arg;
+        }
+      }
+
+      if (!url.empty()) {
+        dependency_manager::install_from_url(url, profile, jobs);
       } else {
-        dependency_manager::install_all_from_config();
+        dependency_manager::install_all_from_config(profile, jobs);
       }
 
     } else if (command == "add") {
@@ -45,20 +64,131 @@ int main(int argc, char *argv[]) {
       dependency_manager::add_local_dependency(argv[2]);
 
     } else if (command == "run") {
-      std::stringstream cmd = project_management::generate_compile_cmd();
+      project_management::RunOptions options;
+      bool profile_given = false;
+      for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-j" || arg == "--jobs") && i + 1 < argc) {
+          options.jobs = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg.rfind("-j", 0) == 0 && arg.size() > 2) {
+          options.jobs = static_cast<unsigned>(std::stoul(arg.substr(2)));
+        } else if (arg == "--trace" && i + 1 < argc) {
+          options.trace = argv[++i];
+        } else if (arg.rfind("--trace=", 0) == 0) {
+          options.trace = arg.substr(8);
+        } else if (arg == "--pgo") {
+          options.pgo = true;
+        } else if (arg == "--bolt") {
+          options.bolt = true;
+        } else {
+          options.profile = arg;
+          profile_given = true;
+        }
+      }
+      if ((options.pgo || options.bolt) && !profile_given)
+        options.profile.clear();
+      project_management::run(options);
 
-      if (argc == 3) {
-        project_management::run(cmd, argv[2]);
-      } else {
-        project_management::run(cmd, "--test");
+    } else if (command == "analyze-build" || command == "analyze-includes") {
+      project_management::RunOptions options;
+      size_t top = command == "analyze-build" ? 10 : 20;
+      for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-j" || arg == "--jobs") && i + 1 < argc) {
+          options.jobs = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg.rfind("-j", 0) == 0 && arg.size() > 2) {
+          options.jobs = static_cast<unsigned>(std::stoul(arg.substr(2)));
+        } else if (arg == "--top" && i + 1 < argc) {
+          top = std::stoul(argv[++i]);
+        } else {
+          options.profile = arg;
+        }
+      }
+      if (command == "analyze-build")
+        project_management::analyze_build(options, top);
+      else
+        project_management::analyze_includes(options, top);
+
+    } else if (command == "self-bench") {
+      project_management::SelfBenchOptions options;
+      for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto count = [&]() {
+          if (i + 1 >= argc)
+            throw std::runtime_error("Missing value for " + arg);
+          return static_cast<unsigned>(std::stoul(argv[++i]));
+        };
+        if (arg == "-j" || arg == "--jobs") {
+          options.jobs = count();
+        } else if (arg == "--sources") {
+          options.project.sources = count();
+        } else if (arg == "--headers") {
+          options.project.headers = count();
+        } else if (arg == "--depth") {
+          options.project.depth = count();
+        } else if (arg == "--deps") {
+          options.project.deps = count();
+        } else if (arg == "--local-deps") {
+          options.project.local_deps = count();
+        } else if (arg == "--repeat") {
+          options.repeat = count();
+        } else if (arg == "--dir" && i + 1 < argc) {
+          options.dir = argv[++i];
+        } else if (arg == "--output" && i + 1 < argc) {
+          options.output = argv[++i];
+        } else {
+          std::cerr << "Unknown self-bench option: " << arg << "\n";
+          return 1;
+        }
+      }
+      project_management::self_bench(argv[0], options);
+
+    } else if (command == "bench") {
+      project_management::BenchOptions options;
+      for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto count = [&]() {
+          if (i + 1 >= argc)
+            throw std::runtime_error("Missing value for " + arg);
+          return std::stoi(argv[++i]);
+        };
+        if (arg == "-j" || arg == "--jobs") {
+          options.jobs = static_cast<unsigned>(count());
+        } else if (arg == "--warmup") {
+          options.warmup = count();
+        } else if (arg == "--repeat") {
+          options.repeat = count();
+        } else if (arg == "--cpu") {
+          options.cpu = count();
+        } else if (arg == "--baseline" && i + 1 < argc) {
+          options.baseline = argv[++i];
+        } else if (arg == "--filter" && i + 1 < argc) {
+          options.filter = argv[++i];
+        } else {
+          options.profile = arg;
+        }
       }
+      project_management::bench(options);
 
     } else if (command == "clean") {
       fs::path zyn_folder = fs::current_path() / ".zyn";
       project_management::clean_project(zyn_folder);
 
     } else if (command == "update") {
-      dependency_manager::update_all_dependencies();
+      std::string profile;
+      unsigned jobs = 0;
+      for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-j" || arg == "--jobs") && i + 1 < argc) {
+          jobs = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg.rfind("-j", 0) == 0 && arg.size() > 2) {
+          jobs = static_cast<unsigned>(std::stoul(arg.substr(2)));
+        } else {
+          profile = arg;
+        }
+      }
+      dependency_manager::update_all_dependencies(profile, jobs);
+
     } else if (command == "ide") {
       if (std::string(argv[2]) == "--vscode") {
         project_management::generate_vscode_files();
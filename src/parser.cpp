@@ -1,11 +1,29 @@
 #include "../include/project_management/parser.hpp"
 #include "../external/tomlplusplus/toml.hpp"
+#include "../include/utils/trace.hpp"
 #include <fstream>
 #include <map>
 #include <sstream>
 
 namespace project_management {
+// Host-specific tuning would leak into every ISA variant and into the
+// dependencies they share, so ISA profiles drop it.
+static std::vector<std::string>
+strip_host_tuning(const std::vector<std::string> &flags) {
+  std::vector<std::string> stripped;
+  for (const auto &flag : flags) {
+    std::istringstream tokens(flag);
+    for (std::string token; tokens >> token;) {
+      if (token.rfind("-march=", 0) != 0 && token != "-mtune=native" &&
+          token != "-mcpu=native")
+        stripped.push_back(token);
+    }
+  }
+  return stripped;
+}
+
 Config parse(std::string config_file) {
+  utils::TraceScope trace("config", "parse " + config_file);
   toml::table tbl = toml::parse_file(config_file);
 
   Config config;
@@ -15,9 +33,17 @@ Config parse(std::string config_file) {
   config.language = tbl["project"]["language"].value_or("C++");
   config.standard = tbl["project"]["standard"].value_or("C++17");
   config.compiler = tbl["project"]["compiler"].value_or("g++");
-  config.sources = tbl["directories"].value_or("src");
-  config.include = tbl["directories"].value_or("include");
-  config.build = tbl["directories"].value_or("build");
+  config.sources = tbl["directories"]["sources"].value_or("src");
+  config.include = tbl["directories"]["include"].value_or("include");
+  config.build = tbl["directories"]["build"].value_or("build");
+  config.bench = tbl["directories"]["bench"].value_or("bench");
+
+  int64_t jobs = tbl["build"]["jobs"].value_or(int64_t{0});
+  config.jobs = jobs > 0 ? static_cast<unsigned>(jobs) : 0;
+  config.compile_cache = tbl["build"]["cache"].value_or(true);
+  config.shallow_deps = tbl["build"]["shallow_deps"].value_or(false);
+  config.trace = tbl["build"]["trace"].value_or("");
+  config.lto = tbl["build"]["lto"].value_or("");
 
   if (auto dep_table = tbl["dependencies"].as_table()) {
     for (auto &[key, val] : *dep_table) {
@@ -29,6 +55,17 @@ Config parse(std::string config_file) {
             dep->contains("tag") ? dep->at("tag").value_or("") : "";
         dependency.path =
             dep->contains("path") ? dep->at("path").value_or("") : "";
+        dependency.shallow = dep->contains("shallow")
+                                 ? dep->at("shallow").value_or(false)
+                                 : config.shallow_deps;
+        if (dep->contains("header_only"))
+          dependency.header_only = dep->at("header_only").value_or(false);
+        if (auto sparse = (*dep)["sparse"].as_array()) {
+          for (auto &path : *sparse) {
+            if (path.is_string())
+              dependency.sparse.push_back(path.value_or(""));
+          }
+        }
 
         config.dependencies[std::string(key.str())] = dependency;
       }
@@ -67,14 +104,59 @@ Config parse(std::string config_file) {
             }
             config.profiles[std::string(profile_name.str())] = flags_vec;
           }
+          if (auto isa_array = (*profile_table)["isa"].as_array()) {
+            std::vector<std::string> levels;
+            for (auto &level : *isa_array) {
+              if (level.is_string())
+                levels.push_back(level.value_or(""));
+            }
+            config.profile_isa[std::string(profile_name.str())] = levels;
+          }
         }
       }
     }
   }
 
+  for (const auto &[profile, levels] : config.profile_isa) {
+    auto it = config.profiles.find(profile);
+    if (!levels.empty() && it != config.profiles.end())
+      it->second = strip_host_tuning(it->second);
+  }
+
+  config.pgo_profile = tbl["pgo"]["profile"].value_or("--release");
+  if (auto training = tbl["pgo"]["training"].as_array()) {
+    for (auto &args : *training) {
+      if (args.is_string())
+        config.pgo_training.push_back(args.value_or(""));
+    }
+  }
+
+  config.bench_profile = tbl["bench"]["profile"].value_or("--release");
+  config.bench_baseline = tbl["bench"]["baseline"].value_or("");
+  int64_t warmup = tbl["bench"]["warmup"].value_or(int64_t{1});
+  config.bench_warmup = warmup > 0 ? static_cast<unsigned>(warmup) : 0;
+  int64_t repeat = tbl["bench"]["repeat"].value_or(int64_t{10});
+  config.bench_repeat = repeat > 1 ? static_cast<unsigned>(repeat) : 2;
+  config.bench_cpu =
+      static_cast<int>(tbl["bench"]["cpu"].value_or(int64_t{-1}));
+
   return config;
 }
 
+void write_checkout_options(std::ostream &out, const Dependency &dep,
+                            const Config &config) {
+  if (dep.shallow != config.shallow_deps)
+    out << ", shallow = " << (dep.shallow ? "true" : "false");
+  if (dep.header_only)
+    out << ", header_only = " << (*dep.header_only ? "true" : "false");
+  if (!dep.sparse.empty()) {
+    out << ", sparse = [";
+    for (size_t i = 0; i < dep.sparse.size(); ++i)
+      out << (i ? ", " : "") << "\"" << dep.sparse[i] << "\"";
+    out << "]";
+  }
+}
+
 void save(const std::string &path, const Config &config) {
   std::ifstream in(path);
   std::stringstream buffer;
@@ -104,6 +186,7 @@ void save(const std::string &path, const Config &config) {
             buffer << ", ";
           buffer << "path = \"" << dep.path << "\"";
         }
+        write_checkout_options(buffer, dep, config);
         buffer << " }\n";
         written[name] = true;
       }
@@ -141,6 +224,7 @@ void save(const std::string &path, const Config &config) {
             buffer << ", ";
           buffer << "path = \"" << dep.path << "\"";
         }
+        write_checkout_options(buffer, dep, config);
         buffer << " }\n";
       }
     }
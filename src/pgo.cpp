@@ -0,0 +1,167 @@
+#include "../include/project_management/pgo.hpp"
+#include "../include/project_management/assembly_cache.hpp"
+#include "../include/project_management/compile_cache.hpp"
+#include "../include/project_management/compile_cmd_generator.hpp"
+#include "../include/project_management/file_state.hpp"
+#include "../include/utils/trace.hpp"
+#include "../include/utils/utils.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace project_management {
+
+fs::path pgo_dir(const Config &cfg, const std::string &profile) {
+  return fs::path(".zyn/pgo") /
+         profile_key(cfg, profile, profile_flags(cfg, profile));
+}
+
+std::string pgo_stamp(const Config &cfg, const std::string &profile) {
+  std::string identity = hash_source_files(cfg);
+  identity += '\0' + compiler_identity(cfg.compiler);
+  identity += '\0' + pgo_dir(cfg, profile).string();
+  for (const auto &args : cfg.pgo_training)
+    identity += '\0' + args;
+
+  if (fs::is_directory(".zyn/lock")) {
+    std::vector<std::string> locks;
+    for (const auto &entry : fs::directory_iterator(".zyn/lock"))
+      locks.push_back(entry.path().string());
+    std::sort(locks.begin(), locks.end());
+    for (const auto &lock : locks)
+      identity += '\0' + lock + '\0' + file_state().hash(lock);
+  }
+
+  return hash_string(identity);
+}
+
+static std::string read_stamp(const fs::path &path) {
+  std::ifstream in(path);
+  std::string stamp;
+  std::getline(in, stamp);
+  return stamp;
+}
+
+static std::string stage_key(const Config &cfg, const std::string &profile,
+                             const std::vector<std::string> &stage_flags) {
+  std::vector<std::string> flags = profile_flags(cfg, profile);
+  flags.insert(flags.end(), stage_flags.begin(), stage_flags.end());
+  return profile_key(cfg, profile, flags);
+}
+
+static std::string mangle(const fs::path &path) {
+  std::string name = path.lexically_normal().string();
+  std::replace(name.begin(), name.end(), '/', '#');
+  return name;
+}
+
+static bool train(const Config &cfg, const fs::path &raw, bool clang) {
+  const std::string binary = "./.zyn/build/" + cfg.name;
+  std::vector<std::string> runs = cfg.pgo_training;
+  if (runs.empty())
+    runs.emplace_back();
+
+  bool ok = true;
+  for (const auto &args : runs) {
+    std::string cmd = binary;
+    if (!args.empty())
+      cmd += " " + args;
+    if (clang)
+      cmd = "LLVM_PROFILE_FILE=\"" + (raw / "%p-%m.profraw").string() +
+            "\" " + cmd;
+
+    utils::TraceScope trace("pgo", "train " + args);
+    if (run_command(cmd) != 0) {
+      std::cerr << "[Zyn] Training run failed: " << cmd << "\n";
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+// GCC names each .gcda after the object it belongs to, so profiles from
+// the instrumented tree are renamed to match the objects of the final one.
+static void rename_gcda(const fs::path &raw, const fs::path &dest,
+                        const fs::path &from_dir, const fs::path &to_dir) {
+  const std::string from = mangle(from_dir);
+  const std::string to = mangle(to_dir);
+
+  fs::create_directories(dest);
+  for (const auto &entry : fs::directory_iterator(raw)) {
+    std::string name = entry.path().filename().string();
+    if (name.rfind(from, 0) != 0)
+      continue;
+    fs::copy_file(entry.path(), dest / (to + name.substr(from.size())),
+                  fs::copy_options::overwrite_existing);
+  }
+}
+
+bool pgo_build(const Config &cfg, const RunOptions &options,
+               dependency_manager::InstallPipeline *pipeline) {
+  const bool clang = is_clang(cfg.compiler);
+  const fs::path root = fs::current_path();
+  const fs::path dir = root / pgo_dir(cfg, options.profile);
+  const fs::path raw = dir / "raw";
+  const fs::path data = clang ? dir / "merged.profdata" : dir / "gcda";
+
+  RunOptions generate = options;
+  RunOptions use = options;
+  if (clang) {
+    generate.stage_flags = {"-fprofile-instr-generate"};
+    use.stage_flags = {"-fprofile-instr-use=" + data.string(),
+                       "-Wno-profile-instr-unprofiled"};
+  } else {
+    const std::string prefix = "-fprofile-prefix-path=" + root.string();
+    generate.stage_flags = {"-fprofile-generate=" + raw.string(),
+                            "-fprofile-update=prefer-atomic", prefix};
+    use.stage_flags = {"-fprofile-use=" + data.string(),
+                       "-fprofile-partial-training", "-Wno-missing-profile",
+                       prefix};
+  }
+
+  const std::string stamp = pgo_stamp(cfg, options.profile);
+  if (read_stamp(dir / "stamp") != stamp || !fs::exists(data)) {
+    std::cout << "[Zyn] PGO: building instrumented binary...\n";
+    fs::remove_all(dir);
+    fs::create_directories(raw);
+    if (!build(cfg, generate, pipeline))
+      return false;
+
+    std::cout << "[Zyn] PGO: running training workload...\n";
+    if (!train(cfg, raw, clang))
+      return false;
+
+    if (clang) {
+      utils::TraceScope trace("pgo", "llvm-profdata merge");
+      std::string merge = "llvm-profdata merge -output=\"" + data.string() +
+                          "\" \"" + raw.string() + "\"";
+      if (run_command(merge) != 0) {
+        std::cerr << "[Zyn] Could not merge profiles with llvm-profdata.\n";
+        return false;
+      }
+    } else {
+      const fs::path profiles = ".zyn/build/profiles";
+      rename_gcda(
+          raw, data,
+          profiles / stage_key(cfg, options.profile, generate.stage_flags),
+          profiles / stage_key(cfg, options.profile, use.stage_flags));
+    }
+    std::ofstream(dir / "stamp") << stamp << "\n";
+
+    // The profile is not a tracked input of the optimized objects, so a new
+    // profile invalidates the whole optimized tree.
+    fs::remove(fs::path(".zyn/cache/profiles") /
+               stage_key(cfg, options.profile, use.stage_flags) / "deps.db");
+  } else {
+    std::cout << "[Zyn] PGO: sources unchanged, reusing profile in "
+              << pgo_dir(cfg, options.profile).string() << "\n";
+  }
+
+  std::cout << "[Zyn] PGO: building optimized binary...\n";
+  Config optimized_cfg = cfg;
+  optimized_cfg.compile_cache = false;
+  return build(optimized_cfg, use, pipeline);
+}
+
+} // namespace project_management
@@ -33,8 +33,11 @@ void create(const ProjectConfig &config) {
   config_file << "[settings.profiles.--release]\n";
   config_file
       << "flags = [\"-w -O3 -ffast-math -finline-functions -funroll-loops"
-         " -fomit-frame-pointer -march=native -flto -DNDEBUG "
-         "-fstrict-aliasing -fmerge-all-constants\"]\n";
+         " -fomit-frame-pointer -flto -DNDEBUG -fstrict-aliasing"
+         " -fmerge-all-constants\"]\n";
+#if defined(__x86_64__) && defined(__linux__)
+  config_file << "isa = [\"x86-64-v2\", \"x86-64-v3\", \"x86-64-v4\"]\n";
+#endif
 
   config_file << "[settings.profiles.--debug]\n";
   config_file
@@ -46,6 +49,9 @@ void create(const ProjectConfig &config) {
   config_file << "include = \"include\"\n";
   config_file << "build = \"build\"\n\n";
 
+  config_file << "[build]\n";
+  config_file << "lto = \"thin\"\n\n";
+
   config_file << "[dependencies]\n\n";
 
   config_file << "[libraries]\n";
@@ -1,9 +1,26 @@
+#include "../include/project_management/runner.hpp"
+#include "../include/dependency_manager/git_dependency.hpp"
+#include "../include/dependency_manager/install_pipeline.hpp"
 #include "../include/project_management/assembly_cache.hpp"
+#include "../include/project_management/bolt.hpp"
+#include "../include/project_management/compile_cache.hpp"
+#include "../include/project_management/compile_cmd_generator.hpp"
+#include "../include/project_management/file_state.hpp"
+#include "../include/project_management/isa.hpp"
 #include "../include/project_management/parser.hpp"
+#include "../include/project_management/pgo.hpp"
+#include "../include/utils/jobserver.hpp"
+#include "../include/utils/thread_pool.hpp"
+#include "../include/utils/trace.hpp"
+#include "../include/utils/utils.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstdlib>
 #include <filesystem>
-#include <future>
 #include <iostream>
+#include <mutex>
+#include <set>
 
 namespace project_management {
 int run_command(const std::string &cmd) {
@@ -15,43 +32,300 @@ int run_command(const std::string &cmd) {
   return ret;
 }
 
-void run(std::stringstream &compile_cmd, const std::string &profile) {
+std::vector<std::string> profile_flags(const Config &cfg,
+                                       const std::string &profile) {
+  if (cfg.profiles.count(profile) > 0) {
+    return cfg.profiles.at(profile);
+  }
+
+  std::cerr << "Error: Profile '" << profile
+            << "' not found in zyn.toml. No compile flags applied.\n";
+  return {};
+}
+
+unsigned resolve_jobs(const Config &cfg, const RunOptions &options) {
+  if (options.jobs > 0)
+    return options.jobs;
+  if (cfg.jobs > 0)
+    return cfg.jobs;
+  return utils::default_jobs();
+}
+
+void publish_output(const BuildPlan &plan) {
   namespace fs = std::filesystem;
-  fs::create_directories(".zyn/build/");
 
-  auto install_future = std::async(std::launch::async,
-                                   []() { return run_command("zyn install"); });
+  fs::path target =
+      plan.output.lexically_relative(plan.published.parent_path());
+  std::error_code ec;
+  if (fs::is_symlink(plan.published, ec) &&
+      fs::read_symlink(plan.published, ec) == target)
+    return;
 
-  install_future.get();
+  fs::path tmp = plan.published;
+  tmp += ".tmp";
+  fs::remove(tmp, ec);
+  fs::create_symlink(target, tmp);
+  fs::rename(tmp, plan.published);
+}
 
-  Config cfg = parse("zyn.toml");
+static std::string dependency_of(const BuildPlan &plan,
+                                 const std::filesystem::path &input) {
+  auto it = input.begin();
+  if (it == input.end() || *it != ".zyn" || ++it == input.end() ||
+      (*it != "deps" && *it != "build") || ++it == input.end())
+    return {};
+
+  const std::string name = it->string();
+  if (!std::binary_search(plan.dependencies.begin(), plan.dependencies.end(),
+                          name))
+    return {};
+  return name;
+}
+
+static std::set<std::string> unit_dependencies(const BuildPlan &plan,
+                                               const CompileUnit &unit,
+                                               const BuildRecord &stored) {
+  auto it = stored.objects.find(unit.object.string());
+  std::vector<std::string> inputs =
+      it != stored.objects.end()
+          ? it->second.inputs
+          : scan_includes(unit.source, plan.include_dirs);
+
+  std::set<std::string> names;
+  for (const auto &input : inputs) {
+    std::string name =
+        dependency_of(plan, std::filesystem::path(input).lexically_normal());
+    if (!name.empty())
+      names.insert(std::move(name));
+  }
+  return names;
+}
+
+bool build(const Config &cfg, const RunOptions &options,
+           dependency_manager::InstallPipeline *pipeline) {
+  namespace fs = std::filesystem;
+
+  if (pipeline)
+    pipeline->wait_configured();
+
+  BuildPlan plan =
+      generate_compile_cmd(cfg, options.profile,
+                           profile_flags(cfg, options.profile),
+                           options.stage_flags, options.link_flags);
+  BuildRecord stored = load_build_record(plan);
+  std::vector<const CompileUnit *> stale = stale_units(plan, stored);
+
+  if (stale.empty()) {
+    if (pipeline && !pipeline->run()) {
+      std::cerr << "Dependency install failed, aborting run.\n";
+      return false;
+    }
+    if (!needs_link(plan, stored)) {
+      save_file_state();
+      publish_output(plan);
+      std::cout << "No changes detected. Using cached build ("
+                << plan.profile_key << ").\n";
+      return true;
+    }
+  }
+
+  BuildRecord next;
+  next.link_hash = stored.link_hash;
+  for (const auto &unit : plan.units) {
+    const std::string key = unit.object.string();
+    if (std::find(stale.begin(), stale.end(), &unit) == stale.end())
+      next.objects[key] = stored.objects.at(key);
+  }
+
+  std::string compiler_id =
+      cfg.compile_cache ? compiler_identity(cfg.compiler) : std::string();
+  const unsigned jobs = resolve_jobs(cfg, options);
+
+  auto dependencies_settled = [&plan, pipeline]() {
+    return !pipeline ||
+           std::all_of(plan.dependencies.begin(), plan.dependencies.end(),
+                       [pipeline](const std::string &name) {
+                         return pipeline->finished(name);
+                       });
+  };
+
+  std::mutex output_mutex;
+  std::condition_variable done_cv;
+  std::atomic<bool> failed{false};
+  std::vector<char> built_flags(stale.size(), 0);
+  size_t remaining = stale.size();
+
+  auto compile = [&](size_t index) {
+    const CompileUnit *unit = stale[index];
+    bool ok = false;
 
-  if (!needs_rebuild(cfg)) {
-    std::cout << "No changes detected. Using cached build.\n";
-  } else {
-    if (cfg.profiles.count(profile) > 0) {
-      for (const auto &flag : cfg.profiles.at(profile)) {
-        compile_cmd << " " << flag;
+    if (!failed) {
+      fs::create_directories(unit->object.parent_path());
+      utils::TraceScope trace("compile", unit->source.string());
+      if (!compiler_id.empty() && restore_object(*unit, compiler_id)) {
+        std::lock_guard<std::mutex> lock(output_mutex);
+        std::cout << "Cached: " << unit->source.string() << "\n";
+        ok = true;
+      } else {
+        bool settled = dependencies_settled();
+        utils::ProcessResult result;
+        {
+          utils::Jobserver::Token token(
+              dependency_manager::shared_jobserver(jobs));
+          result = utils::run_captured(unit->command);
+        }
+        // Missing headers from a dependency still building surface as a
+        // compile error; retry once everything it could need is installed.
+        if (result.exit_code != 0 && !settled) {
+          pipeline->wait();
+          utils::Jobserver::Token token(
+              dependency_manager::shared_jobserver(jobs));
+          result = utils::run_captured(unit->command);
+        }
+        if (result.exit_code == 0 && !compiler_id.empty())
+          store_object(*unit, compiler_id);
+
+        std::lock_guard<std::mutex> lock(output_mutex);
+        std::cout << "Running: " << unit->command << "\n" << result.output;
+        if (result.exit_code != 0) {
+          std::cerr << "Command failed with code " << result.exit_code
+                    << "\n";
+          failed = true;
+        } else {
+          ok = true;
+        }
       }
-    } else {
-      std::cerr << "Error: Profile '" << profile
-                << "' not found in zyn.toml. No compile flags applied.\n";
     }
 
-    int compile_ret = run_command(compile_cmd.str());
-    if (compile_ret != 0) {
-      std::cerr << "Compilation failed, aborting run.\n";
-      return;
+    std::lock_guard<std::mutex> lock(output_mutex);
+    built_flags[index] = ok;
+    --remaining;
+    done_cv.notify_all();
+  };
+
+  {
+    utils::ThreadPool pool(
+        std::min<unsigned>(jobs, static_cast<unsigned>(stale.size())),
+        "compile");
+    std::vector<std::set<std::string>> waiting(stale.size());
+
+    {
+      std::unique_lock<std::mutex> lock(output_mutex);
+      if (pipeline) {
+        pipeline->set_listener([&](const std::string &name, bool) {
+          std::lock_guard<std::mutex> lock(output_mutex);
+          for (size_t i = 0; i < waiting.size(); ++i) {
+            if (waiting[i].erase(name) > 0 && waiting[i].empty())
+              pool.submit([&compile, i]() { compile(i); });
+          }
+        });
+      }
+
+      for (size_t i = 0; i < stale.size(); ++i) {
+        if (pipeline) {
+          for (const auto &name : unit_dependencies(plan, *stale[i], stored)) {
+            if (!pipeline->finished(name))
+              waiting[i].insert(name);
+          }
+        }
+        if (waiting[i].empty())
+          pool.submit([&compile, i]() { compile(i); });
+      }
+
+      done_cv.wait(lock, [&remaining]() { return remaining == 0; });
     }
 
-    update_cache(cfg);
+    if (pipeline)
+      pipeline->set_listener(nullptr);
+
+    std::vector<const CompileUnit *> built;
+    for (size_t i = 0; i < stale.size(); ++i) {
+      if (built_flags[i])
+        built.push_back(stale[i]);
+    }
+    record_objects(built, next);
+  }
+
+  bool ok = !failed;
+  if (ok && pipeline && !pipeline->run()) {
+    std::cerr << "Dependency install failed, aborting run.\n";
+    ok = false;
+  }
+  if (ok) {
+    fs::create_directories(plan.output.parent_path());
+    utils::TraceScope trace("link", plan.output.string());
+    ok = run_command(plan.link_cmd) == 0;
+    if (ok)
+      next.link_hash = link_hash(plan);
+  }
+
+  save_build_record(plan, next);
+  save_file_state();
+
+  if (!ok) {
+    std::cerr << "Compilation failed, aborting run.\n";
+    return false;
+  }
+
+  publish_output(plan);
+  return true;
+}
+
+static void finish_trace(const std::string &path) {
+  if (path.empty())
+    return;
+  if (utils::write_trace(path))
+    std::cout << "[Zyn] Trace written to " << path << "\n";
+  else
+    std::cerr << "[Zyn] Could not write trace to " << path << "\n";
+}
+
+void run(const RunOptions &run_options) {
+  namespace fs = std::filesystem;
+  fs::create_directories(".zyn/build/");
+
+  utils::start_trace();
+  Config cfg = parse("zyn.toml");
+  RunOptions options = run_options;
+  if ((options.pgo || options.bolt) && options.profile.empty())
+    options.profile = cfg.pgo_profile;
+  const std::string trace = options.trace.empty() ? cfg.trace : options.trace;
+  if (trace.empty())
+    utils::stop_trace();
+
+  const unsigned jobs = resolve_jobs(cfg, options);
+  dependency_manager::InstallPipeline pipeline(
+      dependency_manager::make_build_variant(cfg, options.profile, jobs),
+      dependency_manager::pipeline_limits(jobs));
+  for (const auto &[name, dep] : dependency_manager::git_dependencies(cfg))
+    pipeline.add(name, dep);
+
+  // PGO and BOLT train a single binary, so ISA profiles fall back to one
+  // baseline variant for them.
+  const bool isa = !isa_levels(cfg, options.profile).empty();
+  if (isa && (options.pgo || options.bolt))
+    std::cout << "[Zyn] --pgo and --bolt build a single baseline variant of "
+              << options.profile << ".\n";
+
+  bool built = options.bolt  ? bolt_build(cfg, options, &pipeline)
+               : options.pgo ? pgo_build(cfg, options, &pipeline)
+               : isa         ? isa_build(cfg, options, &pipeline)
+                             : build(cfg, options, &pipeline);
+  if (!built) {
+    finish_trace(trace);
+    return;
   }
 
   std::string run_cmd = "./.zyn/build/" + cfg.name;
-  int run_ret = run_command(run_cmd);
+  int run_ret;
+  {
+    utils::TraceScope scope("run", run_cmd);
+    run_ret = run_command(run_cmd);
+  }
+  finish_trace(trace);
   if (run_ret != 0) {
     std::cerr << "Run failed with code " << run_ret << "\n";
   }
 }
 
-} // namespace project_management
\ No newline at end of file
+} // namespace project_management
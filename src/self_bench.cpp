@@ -0,0 +1,308 @@
+#include "../include/project_management/self_bench.hpp"
+#include "../include/dependency_manager/git_dependency.hpp"
+#include "../include/project_management/assembly_cache.hpp"
+#include "../include/project_management/parser.hpp"
+#include "../include/utils/hashing.hpp"
+#include "../include/utils/thread_pool.hpp"
+#include "../include/utils/utils.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace project_management {
+
+using json = nlohmann::json;
+
+static void write_file(const fs::path &path, const std::string &content) {
+  fs::create_directories(path.parent_path());
+  std::ofstream out(path, std::ios::trunc);
+  if (!out)
+    throw std::runtime_error("Could not write " + path.string());
+  out << content;
+}
+
+static std::string header_body(const std::string &guard,
+                               const std::string &name) {
+  // Enough templates and declarations that lexing and parsing cost is
+  // noticeable, without depending on the standard library.
+  std::string body = "#pragma once\n\nnamespace " + name + " {\n";
+  for (int i = 0; i < 8; ++i) {
+    const std::string n = std::to_string(i);
+    body += "template <typename T> struct box" + n +
+            " {\n  T value;\n  T get() const { return value + " + n +
+            "; }\n};\n";
+  }
+  body += "inline int " + guard + "() { return box3<int>{4}.get(); }\n";
+  return body + "} // namespace " + name + "\n";
+}
+
+static void generate_dependency(const fs::path &repo, const std::string &name) {
+  fs::remove_all(repo);
+  write_file(repo / "include" / name / (name + ".h"),
+             header_body(name + "_value", name));
+
+  const std::string git = "git -C \"" + repo.string() + "\"";
+  std::string cmd = git + " init --quiet && " + git + " add -A && " + git +
+                    " -c user.name=zyn -c user.email=zyn@localhost commit "
+                    "--quiet -m synthetic && " +
+                    git + " tag v1";
+  if (std::system(cmd.c_str()) != 0)
+    throw std::runtime_error("Could not create repository " + repo.string());
+}
+
+static const char *marker = ".zyn-self-bench";
+
+void generate_project(const fs::path &dir, const SyntheticProject &spec) {
+  // Only directories created by a previous self-bench run are wiped.
+  if (fs::exists(dir) && !fs::is_empty(dir) && !fs::exists(dir / marker))
+    throw std::runtime_error(dir.string() +
+                             " is not empty and was not created by zyn "
+                             "self-bench, refusing to overwrite it");
+  fs::remove_all(dir);
+  write_file(dir / marker, "");
+  const fs::path project = dir / "project";
+  const unsigned headers = std::max(spec.headers, 1u);
+  const unsigned depth = std::max(spec.depth, 1u);
+
+  std::string toml = "[project]\nversion = \"1.0.0\"\n"
+                     "name = \"synthetic\"\nlanguage = \"cpp\"\n"
+                     "standard = \"c++17\"\ncompiler = \"g++\"\n\n"
+                     "[settings.profiles.--bench]\nflags = [\"-O0\"]\n\n"
+                     "[directories]\nsources = \"src\"\n"
+                     "include = \"include\"\nbuild = \"build\"\n\n"
+                     "[build]\ncache = false\n\n[dependencies]\n";
+  for (unsigned k = 0; k < spec.deps; ++k) {
+    const std::string name = "dep" + std::to_string(k);
+    const fs::path repo = dir / "repos" / name;
+    generate_dependency(repo, name);
+    toml += name + " = { git = \"file://" + repo.string() +
+            "\", tag = \"v1\", header_only = true }\n";
+  }
+  for (unsigned k = 0; k < spec.local_deps; ++k) {
+    const std::string name = "local" + std::to_string(k);
+    const fs::path path = dir / "local" / name;
+    write_file(path / "include" / name / (name + ".h"),
+               header_body(name + "_value", name));
+    toml += name + " = { path = \"" + path.string() + "\" }\n";
+  }
+  toml += "\n[libraries]\nlib_dirs = []\nlibraries = []\n";
+  write_file(project / "zyn.toml", toml);
+
+  // Headers form chains of `depth`, each including the next one.
+  for (unsigned m = 0; m < headers; ++m) {
+    const std::string name = "h" + std::to_string(m);
+    std::string body = header_body(name + "_value", name);
+    if ((m + 1) % depth != 0 && m + 1 < headers)
+      body = "#include \"h" + std::to_string(m + 1) + ".hpp\"\n" + body;
+    write_file(project / "include" / (name + ".hpp"), body);
+  }
+
+  std::string main_cpp;
+  std::string main_body = "int main() {\n  int total = 0;\n";
+  for (unsigned n = 0; n < spec.sources; ++n) {
+    const std::string name = "unit" + std::to_string(n);
+    const unsigned m = (n * depth) % headers;
+    std::string body = "#include \"h" + std::to_string(m) + ".hpp\"\n";
+    std::string value =
+        "h" + std::to_string(m) + "::h" + std::to_string(m) + "_value()";
+    std::vector<std::string> used;
+    if (spec.deps > 0)
+      used.push_back("dep" + std::to_string(n % spec.deps));
+    if (spec.local_deps > 0)
+      used.push_back("local" + std::to_string(n % spec.local_deps));
+    for (const auto &dep : used) {
+      body += "#include <" + dep + "/" + dep + ".h>\n";
+      value += " + " + dep + "::" + dep + "_value()";
+    }
+    body += "\nint " + name + "() { return " + value + "; }\n";
+    write_file(project / "src" / (name + ".cpp"), body);
+
+    main_cpp += "int " + name + "();\n";
+    main_body += "  total += " + name + "();\n";
+  }
+  write_file(project / "src" / "main.cpp",
+             main_cpp + "\n" + main_body + "  return total == 0;\n}\n");
+}
+
+struct Measurement {
+  std::string name;
+  std::vector<double> seconds;
+  uint64_t bytes = 0;
+};
+
+static double elapsed(const std::function<void()> &step) {
+  auto start = std::chrono::steady_clock::now();
+  step();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+static Measurement measure(const std::string &name, unsigned repeat,
+                           const std::function<void()> &prepare,
+                           const std::function<void()> &step) {
+  Measurement result{name, {}, 0};
+  for (unsigned i = 0; i < repeat; ++i) {
+    if (prepare)
+      prepare();
+    result.seconds.push_back(elapsed(step));
+  }
+  return result;
+}
+
+static json summarize(const Measurement &m) {
+  std::vector<double> sorted = m.seconds;
+  std::sort(sorted.begin(), sorted.end());
+  const double mean =
+      std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+  const double median =
+      sorted.size() % 2 ? sorted[sorted.size() / 2]
+                        : (sorted[sorted.size() / 2 - 1] +
+                           sorted[sorted.size() / 2]) /
+                              2;
+
+  json entry = {{"name", m.name},
+                {"samples", m.seconds},
+                {"min", sorted.front()},
+                {"median", median},
+                {"mean", mean}};
+  if (m.bytes > 0) {
+    entry["bytes"] = m.bytes;
+    entry["mib_per_s"] = m.bytes / median / (1024.0 * 1024.0);
+  }
+  return entry;
+}
+
+static fs::path self_path(const std::string &argv0) {
+  std::error_code ec;
+  fs::path self = fs::read_symlink("/proc/self/exe", ec);
+  if (!ec)
+    return self;
+  return fs::absolute(argv0);
+}
+
+void self_bench(const std::string &argv0, const SelfBenchOptions &options) {
+  const fs::path zyn = self_path(argv0);
+  const fs::path output = fs::absolute(options.output);
+  const fs::path dir = fs::absolute(options.dir);
+  const unsigned jobs =
+      options.jobs > 0 ? options.jobs : utils::default_jobs();
+  const unsigned repeat = std::max(options.repeat, 1u);
+
+  std::cout << "[Zyn] Generating synthetic project in " << dir.string()
+            << " (" << options.project.sources << " sources, "
+            << options.project.headers << " headers, depth "
+            << options.project.depth << ", " << options.project.deps
+            << " git deps, " << options.project.local_deps
+            << " local deps)...\n";
+  generate_project(dir, options.project);
+
+  const fs::path cache = dir / "cache";
+  setenv("ZYN_CACHE_DIR", cache.c_str(), 1);
+  fs::current_path(dir / "project");
+
+  auto zyn_cmd = [&](const std::string &args) {
+    return [cmd = "\"" + zyn.string() + "\" " + args + " -j " +
+                  std::to_string(jobs)]() {
+      utils::ProcessResult result = utils::run_captured(cmd);
+      if (result.exit_code != 0)
+        throw std::runtime_error("Benchmark step failed: " + cmd + "\n" +
+                                 result.output);
+    };
+  };
+  auto remove = [](std::vector<fs::path> paths) {
+    return [paths]() {
+      for (const auto &path : paths)
+        fs::remove_all(path);
+    };
+  };
+
+  std::vector<Measurement> results;
+  auto report = [&results](Measurement m) {
+    std::cout << "  " << std::left << std::setw(24) << m.name << std::right;
+    for (double s : m.seconds)
+      std::cout << std::setw(10) << std::fixed << std::setprecision(3) << s;
+    std::cout << " s\n";
+    results.push_back(std::move(m));
+  };
+
+  report(measure("install_cold", repeat,
+                 remove({".zyn/deps", ".zyn/lock", ".zyn/cache/deps",
+                         cache / "git"}),
+                 zyn_cmd("install --bench")));
+  report(measure("install_warm", repeat,
+                 remove({".zyn/deps", ".zyn/cache/deps"}),
+                 zyn_cmd("install --bench")));
+  report(measure("clean_build", repeat,
+                 remove({".zyn/build", ".zyn/cache/profiles",
+                         ".zyn/cache/filestate.db"}),
+                 zyn_cmd("run --bench")));
+  report(measure("noop_run", repeat, nullptr, zyn_cmd("run --bench")));
+
+  unsigned edit = 0;
+  report(measure(
+      "one_file_rebuild", repeat,
+      [&edit]() {
+        std::ofstream("src/unit0.cpp", std::ios::app)
+            << "// edit " << ++edit << "\n";
+      },
+      zyn_cmd("run --bench")));
+
+  Config cfg = parse("zyn.toml");
+  std::vector<std::string> sources;
+  uint64_t source_bytes = 0;
+  for (const char *root : {"src", "include"}) {
+    for (const auto &entry : fs::recursive_directory_iterator(root)) {
+      if (entry.is_regular_file()) {
+        sources.push_back(entry.path().string());
+        source_bytes += entry.file_size();
+      }
+    }
+  }
+
+  Measurement hashed = measure("hash_source_files", repeat, nullptr,
+                               [&cfg]() { hash_source_files(cfg); });
+  hashed.bytes = source_bytes;
+  report(std::move(hashed));
+
+  Measurement raw = measure("fast_hash_files", repeat, nullptr, [&]() {
+    utils::fast_hash_files(sources, jobs);
+  });
+  raw.bytes = source_bytes;
+  report(std::move(raw));
+
+  if (options.project.deps > 0) {
+    const fs::path dep = ".zyn/deps/dep0";
+    Measurement locked = measure("hash_directory", repeat, nullptr, [&dep]() {
+      dependency_manager::hash_directory(dep);
+    });
+    for (const auto &file : dependency_manager::lock_files(dep))
+      locked.bytes += fs::file_size(file);
+    report(std::move(locked));
+  }
+
+  json out = {{"project",
+               {{"sources", options.project.sources},
+                {"headers", options.project.headers},
+                {"depth", options.project.depth},
+                {"deps", options.project.deps},
+                {"local_deps", options.project.local_deps}}},
+              {"jobs", jobs},
+              {"repeat", repeat},
+              {"results", json::array()}};
+  for (const auto &m : results)
+    out["results"].push_back(summarize(m));
+
+  std::ofstream(output) << out.dump(2) << "\n";
+  std::cout << "[Zyn] Results written to " << output.string() << "\n";
+}
+
+} // namespace project_management
@@ -0,0 +1,46 @@
+#include "../include/utils/thread_pool.hpp"
+#include "../include/utils/trace.hpp"
+
+namespace utils {
+unsigned default_jobs() {
+  unsigned jobs = std::thread::hardware_concurrency();
+  return jobs == 0 ? 1 : jobs;
+}
+
+ThreadPool::ThreadPool(unsigned workers, const std::string &name) {
+  if (workers == 0)
+    workers = 1;
+
+  workers_.reserve(workers);
+  for (unsigned i = 0; i < workers; ++i)
+    workers_.emplace_back([this, name, i]() {
+      set_thread_name(name + " " + std::to_string(i + 1));
+      worker_loop();
+    });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  for (auto &worker : workers_)
+    worker.join();
+}
+
+void ThreadPool::worker_loop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty())
+        return;
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+    task();
+  }
+}
+} // namespace utils
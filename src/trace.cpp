@@ -0,0 +1,145 @@
+#include "../include/utils/trace.hpp"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <vector>
+
+namespace utils {
+
+using Clock = std::chrono::steady_clock;
+
+struct TraceEvent {
+  std::string name;
+  const char *category;
+  int64_t start_us;
+  int64_t duration_us;
+  unsigned tid;
+};
+
+struct TraceState {
+  std::atomic<bool> enabled{false};
+  std::mutex mutex;
+  Clock::time_point epoch;
+  std::vector<TraceEvent> events;
+  std::map<unsigned, std::string> threads;
+  unsigned next_tid = 0;
+  unsigned generation = 0;
+};
+
+static TraceState &trace_state() {
+  static TraceState state;
+  return state;
+}
+
+static thread_local std::string thread_name;
+static thread_local unsigned thread_tid = 0;
+static thread_local unsigned thread_generation = 0;
+
+static int64_t now_us(const TraceState &state) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                               state.epoch)
+      .count();
+}
+
+// Called with the state mutex held.
+static unsigned register_thread(TraceState &state) {
+  if (thread_generation != state.generation) {
+    thread_tid = state.next_tid++;
+    thread_generation = state.generation;
+    state.threads[thread_tid] =
+        thread_name.empty() ? "thread " + std::to_string(thread_tid)
+                            : thread_name;
+  }
+  return thread_tid;
+}
+
+TraceScope::TraceScope(const char *category, std::string name)
+    : category_(category) {
+  TraceState &state = trace_state();
+  if (!state.enabled.load(std::memory_order_relaxed))
+    return;
+  name_ = std::move(name);
+  start_us_ = now_us(state);
+}
+
+TraceScope::~TraceScope() {
+  if (start_us_ < 0)
+    return;
+
+  TraceState &state = trace_state();
+  int64_t end_us = now_us(state);
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (!state.enabled)
+    return;
+  state.events.push_back({std::move(name_), category_, start_us_,
+                          end_us - start_us_, register_thread(state)});
+}
+
+void start_trace() {
+  TraceState &state = trace_state();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.epoch = Clock::now();
+  state.events.clear();
+  state.threads.clear();
+  state.next_tid = 0;
+  ++state.generation;
+  if (thread_name.empty())
+    thread_name = "main";
+  register_thread(state);
+  state.enabled = true;
+}
+
+void stop_trace() {
+  TraceState &state = trace_state();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.enabled = false;
+  state.events.clear();
+  state.threads.clear();
+}
+
+bool write_trace(const std::filesystem::path &path) {
+  TraceState &state = trace_state();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.enabled = false;
+
+  nlohmann::json events = nlohmann::json::array();
+  for (const auto &[tid, name] : state.threads) {
+    events.push_back({{"name", "thread_name"},
+                      {"ph", "M"},
+                      {"pid", 1},
+                      {"tid", tid},
+                      {"args", {{"name", name}}}});
+  }
+  for (const auto &event : state.events) {
+    events.push_back({{"name", event.name},
+                      {"cat", event.category},
+                      {"ph", "X"},
+                      {"ts", event.start_us},
+                      {"dur", event.duration_us},
+                      {"pid", 1},
+                      {"tid", event.tid}});
+  }
+
+  if (path.has_parent_path())
+    std::filesystem::create_directories(path.parent_path());
+  std::ofstream out(path, std::ios::trunc);
+  out << nlohmann::json{{"traceEvents", events}, {"displayTimeUnit", "ms"}}
+             .dump(-1, ' ', false, nlohmann::json::error_handler_t::replace)
+      << '\n';
+  state.events.clear();
+  state.threads.clear();
+  return static_cast<bool>(out);
+}
+
+void set_thread_name(const std::string &name) {
+  thread_name = name;
+  TraceState &state = trace_state();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (state.enabled && thread_generation == state.generation)
+    state.threads[thread_tid] = name;
+}
+
+} // namespace utils
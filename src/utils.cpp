@@ -1,5 +1,9 @@
 #include "../include/utils/utils.hpp"
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <stdexcept>
+#include <sys/wait.h>
 
 namespace utils {
 
@@ -10,4 +14,36 @@ std::string input_with_prompt(const std::string &prompt) {
   return input;
 }
 
-} // namespace utils
\ No newline at end of file
+ProcessResult run_captured(const std::string &cmd) {
+  std::string full_cmd = cmd + " 2>&1";
+  FILE *pipe = popen(full_cmd.c_str(), "r");
+  if (!pipe)
+    throw std::runtime_error("Failed to run command: " + cmd);
+
+  ProcessResult result{0, {}};
+  char buffer[4096];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0)
+    result.output.append(buffer, n);
+
+  int status = pclose(pipe);
+  if (status == -1)
+    result.exit_code = -1;
+  else if (WIFEXITED(status))
+    result.exit_code = WEXITSTATUS(status);
+  else if (WIFSIGNALED(status))
+    result.exit_code = 128 + WTERMSIG(status);
+  return result;
+}
+
+std::filesystem::path user_cache_dir() {
+  if (const char *dir = std::getenv("ZYN_CACHE_DIR"); dir && *dir)
+    return dir;
+  if (const char *dir = std::getenv("XDG_CACHE_HOME"); dir && *dir)
+    return std::filesystem::path(dir) / "zyn";
+  if (const char *home = std::getenv("HOME"); home && *home)
+    return std::filesystem::path(home) / ".cache" / "zyn";
+  return std::filesystem::temp_directory_path() / "zyn-cache";
+}
+
+} // namespace utils